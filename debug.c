@@ -22,30 +22,61 @@
 // WARNING:
 //   The serial port uses timer 1 for baud rate generation!
 //
+//   In the DEBUG version the serial port is interrupt driven once main() sets
+// ES.  putchar() just puts the character in a small ring buffer and returns,
+// and DEBUG_SERIAL() sends it whenever the UART is free.  At 2400 baud that's
+// over 4ms per character, and waiting for each one (which is what we used to
+// do) slowed everything down so much that the keyboard buffer overflowed
+// while we were trying to debug.  If the ring buffer fills up, the rest of
+// that message (up to the next newline) is thrown away and g_wDebugDrops is
+// incremented instead.  That way the debug version runs at the same speed as
+// the real thing, and you lose some messages rather than keystrokes.
+//
+//   The firmware itself doesn't print messages any more, though - it sends
+// binary trace records with Trace() (see trace.h) and ps2trace decodes them.
+// putchar() is still here for anybody who wants to use printf_tiny(), but it
+// costs a lot of code space!
+//
+//   With DEBUG_MONITOR, characters received are commands for the monitor in
+// host.c, except for the "I" command, which is handled right here in the ISR.
+// "I" is followed by a count and then that many bytes, which are put straight
+// into the keyboard buffer as if the keyboard had sent them.  Doing that at
+// interrupt level means that they're never lost, no matter how busy the
+// background is, so a recorded typing session can be sent as fast as the
+// serial port can go (at 2400 baud, that's 240 bytes a second).
+//
 //REVISION HISTORY:
 // dd-mmm-yy    who     description
 //  4-Feb-06    RLA     New file.
 // 12-May-24	RLA	Add putchar() and getchar() to this file.
 //			Add USE_SMOD to control setting the SMOD bit.
 //			putchar() should add a <CR> to every <LF>.
+// 16-Oct-26	RLA	InitializeSerial() is used by HOST_UART too.
+// 16-Oct-26	RLA	Make the debug output interrupt driven.
+// 16-Oct-26	RLA	Add Trace() for binary trace records.
+// 16-Oct-26	RLA	Add scan code injection, PollDebug() and TraceWait().
+// 16-Oct-26	RLA	Never wait for a UART that hasn't been initialized.
 //--
 
 // Include files...
-#include <stdio.h>		// needed so DBGOUT(()) can find printf!
+#include <stdio.h>		// putchar(), et al ...
 #include <stdint.h>		// uint8_t, et al ...
+#include <stdbool.h>		// bool, true, false ...
 #include "at89x051.h"		// register definitions for the AT89C2051
 #include "ps2apu.h"		// declarations for this project
+#include "trace.h"		// TR_xxx trace event codes
 #include "debug.h"		// declarations for this module
+#include "keyboard.h"		// InjectKey() for the monitor
 
 
-#ifdef DEBUG
-PUBLIC void InitializeDebugSerial (void)
+#if defined(DEBUG) || HOST_UART
+PUBLIC void InitializeSerial (void)
 {
   //++
   //   This routine will initialize the 8051's internal UART.  This interface
-  // is used only for debugging purposes, so the baud rate is fixed.  Timer 1 is
-  // used to generate the baud rate clock, and interrupts are _not_ enabled for
-  // the UART!
+  // is used either for debugging or, with the HOST_UART option, to talk to the
+  // host.  The baud rate is fixed at build time.  Timer 1 is used to generate
+  // the baud rate clock, and interrupts are _not_ enabled for the UART here!
   //--
   SCON = 0x52;			// select mode 1 - 8 bit UART, set REN, TI
   TMOD = (TMOD & 0x0F) | 0x20;	// timer 1 mode 2 - 8 bit auto reload
@@ -59,6 +90,64 @@ PUBLIC void InitializeDebugSerial (void)
   TI = 1;			// enable the transmitter
 //REN = 1;			// enable the receiver
 }
+#endif	// #if defined(DEBUG) || HOST_UART ...
+
+
+#ifdef DEBUG
+// Debug output ring buffer and receiver state ...
+PRIVATE uint8_t __data m_abDebugBuffer[DBGBUFLEN];// characters waiting to send
+PRIVATE volatile uint8_t __data m_bDebugGet;	// ring buffer "get" pointer
+PRIVATE uint8_t __data m_bDebugPut;		//  "     "    "put"   "   "
+PRIVATE __bit m_fDebugBusy;			// -> the UART is sending now
+PRIVATE __bit m_fDebugDropping;			// -> throwing away a message
+PRIVATE uint8_t __data m_bTraceLost;		// trace records lost since last TR_LOST
+PRIVATE volatile uint8_t __data m_bDebugRx;	// last character received
+PRIVATE volatile __bit m_fDebugRx;		// -> m_bDebugRx is valid
+PUBLIC uint16_t __data g_wDebugDrops;		// count of messages dropped
+#if DEBUG_MONITOR
+PRIVATE uint8_t __data m_bInjectCount;		// bytes left to inject
+PRIVATE __bit m_fInjectStart;			// -> next byte is the count
+#endif
+
+// Number of free bytes in the debug ring buffer ...
+#define DEBUG_FREE	((uint8_t) (m_bDebugGet - m_bDebugPut - 1) & (DBGBUFLEN-1))
+
+
+//++
+//   Send one character the old fashioned way, by waiting for the UART.  This
+// is used only if the serial interrupt isn't enabled.  If InitializeSerial()
+// hasn't been called yet either (timer 1 isn't running), then TI will never
+// be set and we'd wait forever, so the character is just thrown away ...
+//--
+PRIVATE void SendDebug (uint8_t c)
+{
+  if (!TR1) return;
+  while (!TI) ;
+  SBUF = c;  TI = 0;
+}
+
+
+//++
+//   Add one character to the debug ring buffer.  The caller has to make sure
+// there's room ...
+//--
+PRIVATE void PutDebug (uint8_t c)
+{
+  m_abDebugBuffer[m_bDebugPut] = c;
+  m_bDebugPut = (m_bDebugPut+1) & (DBGBUFLEN-1);
+}
+
+
+//++
+//   If the UART is idle, then setting TI will start DEBUG_SERIAL() going.  If
+// it's busy then it'll find the new characters by itself ...
+//--
+PRIVATE void StartDebug (void)
+{
+  if (!m_fDebugBusy) {
+    m_fDebugBusy = true;  TI = 1;
+  }
+}
 
 
 PUBLIC int putchar (int c)
@@ -74,28 +163,130 @@ PUBLIC int putchar (int c)
   // We could make putchar() reentrant, but that has some other consequences
   // that I don't want to deal with.  Easier to just brute force it!
   //--
-  if (LOBYTE(c) == '\n') {
-    // Output a carriage return first ...
-    while (!TI) ;
-    SBUF = '\r';  TI = 0;
+  if (!ES) {
+    if (LOBYTE(c) == '\n') SendDebug('\r');
+    SendDebug(c);  return c;
   }
 
-  // Now output the original character ...
-  while (!TI) ;
-  SBUF = c;  TI = 0;
+  //   If we're throwing away a message, keep doing that until the newline.
+  // Otherwise make sure there's room for this character, and the carriage
+  // return too if it's a newline ...
+  if (m_fDebugDropping) {
+    if (LOBYTE(c) == '\n') m_fDebugDropping = false;
+    return c;
+  }
+  if (DEBUG_FREE < ((LOBYTE(c) == '\n') ? 2 : 1)) {
+    ++g_wDebugDrops;  m_fDebugDropping = (LOBYTE(c) != '\n');
+    return c;
+  }
+  if (LOBYTE(c) == '\n') PutDebug('\r');
+  PutDebug(LOBYTE(c));  StartDebug();
   return c;
 }
 
 
+//++
+//   Send a binary trace record (see trace.h).  The number of data bytes is in
+// the upper two bits of bEvent, and b1 and b2 are the data.  A record is either
+// sent whole or not at all, so the stream never gets out of step.  Lost
+// records are counted, and the count is sent as a TR_LOST record as soon as
+// there's room ...
+//--
+PUBLIC void Trace (uint8_t bEvent, uint8_t b1, uint8_t b2)
+{
+  uint8_t bLength = (bEvent >> 6) + 1;
+  if (!ES) {
+    SendDebug(bEvent);
+    if (bLength > 1) SendDebug(b1);
+    if (bLength > 2) SendDebug(b2);
+    return;
+  }
+  if (DEBUG_FREE < bLength + ((m_bTraceLost != 0) ? 2 : 0)) {
+    if (m_bTraceLost != 255) ++m_bTraceLost;
+    ++g_wDebugDrops;  return;
+  }
+  if (m_bTraceLost != 0) {
+    PutDebug(TR_LOST|TRACE_1BYTE);  PutDebug(m_bTraceLost);  m_bTraceLost = 0;
+  }
+  PutDebug(bEvent);
+  if (bLength > 1) PutDebug(b1);
+  if (bLength > 2) PutDebug(b2);
+  StartDebug();
+}
+
+
+//++
+//   This is the same as Trace(), except that it waits for room in the ring
+// buffer instead of throwing the record away.  The monitor uses it so that
+// nothing it was asked for gets lost ...
+//--
+PUBLIC void TraceWait (uint8_t bEvent, uint8_t b1, uint8_t b2)
+{
+  while (ES && (DEBUG_FREE < 5)) ;
+  Trace(bEvent, b1, b2);
+}
+
+
+//++
+//   Return the next character received, or -1 if there isn't one.  Unlike
+// getkey(), this never waits ...
+//--
+PUBLIC int PollDebug (void)
+{
+  if (!m_fDebugRx) return -1;
+  m_fDebugRx = false;  return m_bDebugRx;
+}
+
+
 PUBLIC int getkey (void)
 {
   //++
   //   This function waits for a character to be received on the 8051's serial
-  // port.  The character received is returned as the function's value.
+  // port.  The character received is returned as the function's value.  Once
+  // the serial interrupt is enabled, DEBUG_SERIAL() does the receiving ...
   //--
-  while (!RI) ;
-  char c = SBUF;
-  RI = 0;
+  char c;
+  if (!ES) {
+    while (!RI) ;
+    c = SBUF;  RI = 0;
+  } else {
+    while (!m_fDebugRx) ;
+    c = m_bDebugRx;  m_fDebugRx = false;
+  }
   return c;
 }
+
+
+//++
+//   This is the serial port interrupt for the DEBUG version.  Every time the
+// UART finishes sending a character it sends the next one from the ring
+// buffer, and when the buffer is empty it just stops.  Received characters
+// are saved for getkey() - RI has to be cleared here in any case, or we'd be
+// interrupted forever.  The monitor's "I" command is handled here too ...
+//--
+PUBLIC void DEBUG_SERIAL (void) __interrupt (4)
+{
+  if (RI) {
+#if DEBUG_MONITOR
+    if (m_bInjectCount != 0) {
+      InjectKey(SBUF);  --m_bInjectCount;
+    } else if (m_fInjectStart) {
+      m_bInjectCount = SBUF;  m_fInjectStart = false;
+    } else if (SBUF == 'I') {
+      m_fInjectStart = true;
+    } else
+#endif
+    {
+      m_bDebugRx = SBUF;  m_fDebugRx = true;
+    }
+    RI = 0;
+  }
+  if (!TI) return;
+  TI = 0;
+  if (m_bDebugGet == m_bDebugPut) {
+    m_fDebugBusy = false;  return;
+  }
+  SBUF = m_abDebugBuffer[m_bDebugGet];
+  m_bDebugGet = (m_bDebugGet+1) & (DBGBUFLEN-1);
+}
 #endif	// #ifdef DEBUG ...
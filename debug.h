@@ -22,6 +22,10 @@
 //  4-Feb-06    RLA     New file.
 // 12-May-24	RLA	Add prototypes for getchar() and putchar()
 //			Add baud options for 12MHz and 14.31813MHz.
+// 16-Oct-26	RLA	Add BAUD_RATE and rename InitializeSerial().
+// 16-Oct-26	RLA	Add DBGBUFLEN and DEBUG_SERIAL().
+// 16-Oct-26	RLA	Replace DBGOUT() with binary TRACEn() records.
+// 16-Oct-26	RLA	Add DEBUG_MONITOR.
 //--
 #pragma once
 
@@ -30,7 +34,22 @@
 //
 //  T1RELOAD = 256 - ( CPU_CLOCK / (16*12*BAUD_RATE) ) [SMOD == 1]
 //  T1RELOAD = 256 - ( CPU_CLOCK / (32*12*BAUD_RATE) ) [SMOD == 0]
-#if   (CPUCLOCK == 11059200UL)
+//
+//   If BAUD_RATE is defined, the reload value is computed for that rate with
+// SMOD==1, and it's an error if the CPUCLOCK can't get within 2% of it.
+// Otherwise these are the defaults for the usual crystals ...
+#if defined(BAUD_RATE)
+#define USE_SMOD	1
+#define T1DIVISOR	((CPUCLOCK + 96UL*BAUD_RATE) / (192UL*BAUD_RATE))
+#if (T1DIVISOR < 1) || (T1DIVISOR > 255)
+#error BAUD_RATE is out of range for this CPUCLOCK!
+#endif
+#define T1RELOAD	(256 - T1DIVISOR)
+#define BAUD_ACTUAL	(CPUCLOCK / (192UL*T1DIVISOR))
+#if ((BAUD_ACTUAL > BAUD_RATE) ? (BAUD_ACTUAL-BAUD_RATE) : (BAUD_RATE-BAUD_ACTUAL)) * 50UL > BAUD_RATE
+#error BAUD_RATE can not be generated within 2% with this CPUCLOCK!
+#endif
+#elif (CPUCLOCK == 11059200UL)
 //   A 11.0592MHz crystal, not surprisingly, can generate pretty much any
 // standard baud rate with 100% accuracy.  We'll stick to 9600 for convenience.
 #define T1RELOAD	0xFD	// 9600 bps with SMOD==0 and 11.0592MHz clock
@@ -49,22 +68,47 @@
 // rates higher than 2400 have way too much error.
 #define T1RELOAD	0xE1	// 2400 bps with SMOD==1 and 14.31818MHz clock
 #define USE_SMOD	1
-#elif
+#else
 #error Undefined CPUCLOCK for baud rate!
 #endif
 
-// Debugging macros...
+//   Size of the debug output ring buffer (see debug.c).  This MUST BE A POWER
+// OF TWO, and it shouldn't be too big - RAM is scarce!
+#ifndef DBGBUFLEN
+#define DBGBUFLEN	16
+#endif
+#if (DBGBUFLEN & (DBGBUFLEN-1)) != 0
+#error DBGBUFLEN must be a power of two
+#endif
+
+//   DEBUG_MONITOR adds a little command monitor on the debug serial port (see
+// Monitor() in host.c) that can inject scan codes for load testing.  Turn it
+// off if the DEBUG version doesn't fit ...
+#ifndef DEBUG_MONITOR
+#define DEBUG_MONITOR	1
+#endif
+
+//   Debug tracing.  These send a trace record (see trace.h) with zero, one or
+// two data bytes in the DEBUG version, and do nothing otherwise ...
 #ifdef DEBUG
-#define DBGOUT(x)	printf_tiny x
-#define ASSERT(c,x)	if (!(c)) printf_tiny x
-#define VERIFY(c,x)	if (!(c)) printf_tiny x
+#define TRACE0(e)	Trace((e), 0, 0)
+#define TRACE1(e,a)	Trace((e)|TRACE_1BYTE, (a), 0)
+#define TRACE2(e,a,b)	Trace((e)|TRACE_2BYTES, (a), (b))
 #else
-#define DBGOUT(x)
-#define ASSERT(c,x)
-#define VERIFY(c,x)	c 
+#define TRACE0(e)
+#define TRACE1(e,a)
+#define TRACE2(e,a,b)
 #endif
 
 // Intialize the 8051's internal UART ...
-extern void InitializeDebugSerial (void);
+extern void InitializeSerial (void);
 extern int putchar (int c);
 extern int getchar (void);
+#ifdef DEBUG
+extern void Trace (uint8_t bEvent, uint8_t b1, uint8_t b2);
+extern void TraceWait (uint8_t bEvent, uint8_t b1, uint8_t b2);
+extern int PollDebug (void);
+extern int getkey (void);
+extern void DEBUG_SERIAL (void) __interrupt (4);
+extern uint16_t __data g_wDebugDrops;
+#endif
@@ -0,0 +1,229 @@
+//++
+//escape.c - send special keys to the host as VT52, VT100 or ANSI sequences
+//
+// Copyright (C) 2006-2024 by Spare Time Gizmos.  All rights reserved.
+//
+// This file is part of the Spare Time Gizmos' VT1802 and VIS1802 firmware.
+//
+// This firmware is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+// Place, Suite 330, Boston, MA  02111-1307  USA.
+//
+//DESCRIPTION:
+//   Normally all the special keys - function keys, arrow keys, editing keypad
+// and numeric keypad keys - send single byte codes in the range 0x80..0xAF
+// and the host translates them into escape sequences.  That's flexible, but
+// the 1802 hosts are a lot slower than we are, so this module can optionally
+// do the translation here instead.  There are four key modes -
+//
+//	KEYMODE_CODES - send the 0x80..0xAF codes, exactly as before
+//	KEYMODE_VT52  - send VT52 sequences (ESC A, ESC P, ESC ? p, ...)
+//	KEYMODE_VT100 - send VT100/VT220 sequences (ESC [ A, ESC O P, ESC [ 2 ~)
+//	KEYMODE_ANSI  - like VT100, but HOME and END send ESC [ H and ESC [ F
+//
+// The default mode is set by KEY_MODE in the Makefile, and CONTROL+ALT+F9
+// thru F12 selects modes 0 thru 3 at any time.
+//
+//   In any of the escape sequence modes the NUM LOCK key toggles the numeric
+// keypad between numeric mode, where the keys send their digits, and
+// application mode, where they send ESC ? x (VT52) or ESC O x (VT100/ANSI).
+// NUM LOCK itself isn't sent to the host in those modes.  We have no way for
+// the host to tell us which keypad mode it wants, so this is the best we can
+// do.  Special keys that have no sequence in the current mode (e.g. PAUSE/
+// BREAK, MENU, or F5..F12 in VT52 mode) still send their usual codes.
+//
+//   The sequence tables are compact - one byte per key per mode.  Each byte
+// is one of -
+//
+//	0x00	     - no sequence; send the special key code unchanged
+//	0x01..0x3F   - send this single ASCII character (e.g. keypad digits)
+//	0x40..0x7F   - send ESC, the first introducer for this mode, and then
+//		       this byte (e.g. ESC [ A, or just ESC A for VT52)
+//	0x80..0xBF   - send ESC, the second introducer (ESC O or ESC ?) and then
+//		       this byte less 0x40
+//	0xC0..0xFF   - send ESC [ n ~, where n is the low six bits
+//
+//REVISION HISTORY:
+// dd-mmm-yy    who     description
+// 16-Oct-26	RLA	New file.
+// 16-Oct-26	RLA	Use TRACEn() instead of DBGOUT().
+// 16-Oct-26	RLA	Don't toggle the keypad mode when NUM LOCK repeats.
+//--
+#include <stdint.h>		// uint8_t, et al ...
+#include <stdbool.h>		// bool, true, false ...
+#include "at89x051.h"		// register definitions for the AT89C2051
+#include "ps2apu.h"		// definitions for this project
+#include "trace.h"		// TR_xxx trace event codes
+#include "debug.h"		// debuging (serial port output) routines
+#include "scancode.h"		// KEY_xxx special key codes
+#include "host.h"		// SendHost()
+#include "escape.h"		// declarations for this module
+
+// Sequence table encoding (see above) ...
+#define SEQ1(c)		(c)			// ESC <intro1> c
+#define SEQ2(c)		(0x80 | ((c) & 0x3F))	// ESC <intro2> c
+#define SEQN(n)		(0xC0 | (n))		// ESC [ n ~
+#define SEQ_FIRST	KEY_BREAK		// first key in the tables
+#define SEQ_COUNT	(KEY_KPENTER-KEY_BREAK+1)// and number of keys
+
+// Current key mode and keypad state ...
+PRIVATE uint8_t __data m_bKeyMode;		// current KEYMODE_xxx
+PRIVATE uint8_t const __code * __data m_pbSequences;// sequences for this mode
+PRIVATE uint8_t __data m_bIntro1, m_bIntro2;	// introducers for this mode
+PRIVATE __bit m_fAppKeypad;			// keypad application mode
+PRIVATE __bit m_fNumLockDown;			// NUM LOCK is being held down
+
+
+//++
+//   Sequences for every special key, KEY_BREAK (0x80) thru KEY_KPENTER (0xAF)
+// in the VT52, VT100 and ANSI modes.  The numeric keypad entries are for
+// numeric mode - application mode uses m_abAppKeypad[] instead.
+//--
+PRIVATE uint8_t const __code m_abSequences[KEYMODE_COUNT-1][SEQ_COUNT] = {
+  // VT52 ...
+  {
+    0,         SEQ1('P'), SEQ1('Q'), SEQ1('R'),	// BREAK, F1..F3
+    SEQ1('S'), 0,         0,         0,		// F4..F7
+    0,         0,         0,         0,		// F8..F11
+    0,         0,         0,         0,		// F12, SCRLCK, NUMLOCK, -
+    SEQ1('A'), SEQ1('B'), SEQ1('C'), SEQ1('D'),	// UP, DOWN, RIGHT, LEFT
+    0,         0,         0,         SEQ1('H'),	// -, MENU, END, HOME
+    0,         0,         0,         0,		// INSERT, PGDN, PGUP, DELETE
+    0,         0,         0,         0,		// -, -, -, -
+    '0',       '1',       '2',       '3',	// KP0..KP3
+    '4',       '5',       '6',       '7',	// KP4..KP7
+    '8',       '9',       '.',       '+',	// KP8, KP9, KP., KP+
+    '/',       '*',       '-',       0x0D,	// KP/, KP*, KP-, KPENTER
+  },
+  // VT100 ...
+  {
+    0,         SEQ2('P'), SEQ2('Q'), SEQ2('R'),	// BREAK, F1..F3
+    SEQ2('S'), SEQN(15),  SEQN(17),  SEQN(18),	// F4..F7
+    SEQN(19),  SEQN(20),  SEQN(21),  SEQN(23),	// F8..F11
+    SEQN(24),  0,         0,         0,		// F12, SCRLCK, NUMLOCK, -
+    SEQ1('A'), SEQ1('B'), SEQ1('C'), SEQ1('D'),	// UP, DOWN, RIGHT, LEFT
+    0,         0,         SEQN(4),   SEQN(1),	// -, MENU, END, HOME
+    SEQN(2),   SEQN(6),   SEQN(5),   SEQN(3),	// INSERT, PGDN, PGUP, DELETE
+    0,         0,         0,         0,		// -, -, -, -
+    '0',       '1',       '2',       '3',	// KP0..KP3
+    '4',       '5',       '6',       '7',	// KP4..KP7
+    '8',       '9',       '.',       '+',	// KP8, KP9, KP., KP+
+    '/',       '*',       '-',       0x0D,	// KP/, KP*, KP-, KPENTER
+  },
+  // ANSI ...
+  {
+    0,         SEQ2('P'), SEQ2('Q'), SEQ2('R'),	// BREAK, F1..F3
+    SEQ2('S'), SEQN(15),  SEQN(17),  SEQN(18),	// F4..F7
+    SEQN(19),  SEQN(20),  SEQN(21),  SEQN(23),	// F8..F11
+    SEQN(24),  0,         0,         0,		// F12, SCRLCK, NUMLOCK, -
+    SEQ1('A'), SEQ1('B'), SEQ1('C'), SEQ1('D'),	// UP, DOWN, RIGHT, LEFT
+    0,         0,         SEQ1('F'), SEQ1('H'),	// -, MENU, END, HOME
+    SEQN(2),   SEQN(6),   SEQN(5),   SEQN(3),	// INSERT, PGDN, PGUP, DELETE
+    0,         0,         0,         0,		// -, -, -, -
+    '0',       '1',       '2',       '3',	// KP0..KP3
+    '4',       '5',       '6',       '7',	// KP4..KP7
+    '8',       '9',       '.',       '+',	// KP8, KP9, KP., KP+
+    '/',       '*',       '-',       0x0D,	// KP/, KP*, KP-, KPENTER
+  }
+};
+
+//   Numeric keypad keys in application mode, KEY_KP0 thru KEY_KPENTER.  These
+// are the same in every mode - only the introducer changes.  Keypad "+" sends
+// the VT100 keypad "," code, since that's the key in the same position.
+PRIVATE uint8_t const __code m_abAppKeypad[KEY_KPENTER-KEY_KP0+1] = {
+  SEQ2('p'), SEQ2('q'), SEQ2('r'), SEQ2('s'),	// KP0..KP3
+  SEQ2('t'), SEQ2('u'), SEQ2('v'), SEQ2('w'),	// KP4..KP7
+  SEQ2('x'), SEQ2('y'), SEQ2('n'), SEQ2('l'),	// KP8, KP9, KP., KP+
+  SEQ2('o'), SEQ2('j'), SEQ2('m'), SEQ2('M'),	// KP/, KP*, KP-, KPENTER
+};
+
+// Escape sequence introducers for each mode - zero means none ...
+PRIVATE uint8_t const __code m_abIntros[KEYMODE_COUNT-1][2] = {
+  {0,   '?'},		// VT52  - ESC x and ESC ? x
+  {'[', 'O'},		// VT100 - ESC [ x and ESC O x
+  {'[', 'O'},		// ANSI  -  "    "   "    "   "
+};
+
+
+//++
+//   Select the key mode.  This always resets the numeric keypad to numeric
+// mode, and out of range modes are ignored.
+//--
+PUBLIC void SelectKeyMode (uint8_t bMode)
+{
+  if (bMode >= KEYMODE_COUNT) return;
+  TRACE1(TR_KEYMODE, bMode);
+  m_bKeyMode = bMode;  m_fAppKeypad = false;
+  if (bMode == KEYMODE_CODES) return;
+  m_pbSequences = m_abSequences[bMode-1];
+  m_bIntro1 = m_abIntros[bMode-1][0];  m_bIntro2 = m_abIntros[bMode-1][1];
+}
+
+
+//++
+//   Send a key code to the host.  Ordinary ASCII characters are just sent as
+// is, and so are special keys in KEYMODE_CODES.  In the other modes special
+// keys are translated to escape sequences as described above.
+//--
+PUBLIC void SendKey (uint8_t bCode)
+{
+  uint8_t bSequence;
+  if ((m_bKeyMode == KEYMODE_CODES)
+   || (bCode < SEQ_FIRST) || (bCode > KEY_KPENTER)) {
+    SendHost(bCode);  return;
+  }
+
+  //   NUM LOCK toggles the keypad application mode and isn't sent.  Holding it
+  // down only counts once, no matter how many times the keyboard repeats it,
+  // until ReleaseKey() says it's been let go.  Otherwise look up the sequence
+  // for this key ...
+  if (bCode == KEY_NUMLOCK) {
+    if (!m_fNumLockDown) m_fAppKeypad = !m_fAppKeypad;
+    m_fNumLockDown = true;  return;
+  }
+  if (m_fAppKeypad && (bCode >= KEY_KP0))
+    bSequence = m_abAppKeypad[bCode-KEY_KP0];
+  else
+    bSequence = m_pbSequences[bCode-SEQ_FIRST];
+
+  // Send the sequence ...
+  if (bSequence == 0) {
+    SendHost(bCode);
+  } else if (bSequence < 0x40) {
+    SendHost(bSequence);
+  } else {
+    SendHost(0x1B);
+    if (bSequence >= 0xC0) {
+      // ESC [ n ~ ...
+      bSequence &= 0x3F;
+      SendHost('[');
+      if (bSequence >= 10) SendHost('0' + bSequence/10);
+      SendHost('0' + bSequence%10);  SendHost('~');
+    } else {
+      // ESC <intro> x ...
+      uint8_t bIntro = (bSequence & 0x80) ? m_bIntro2 : m_bIntro1;
+      if (bIntro != 0) SendHost(bIntro);
+      SendHost((bSequence & 0x3F) | 0x40);
+    }
+  }
+}
+
+
+//++
+//   This is called when a special key is released.  Nothing is sent to the
+// host, but it's how SendKey() knows that NUM LOCK isn't held down anymore.
+//--
+PUBLIC void ReleaseKey (uint8_t bCode)
+{
+  if (bCode == KEY_NUMLOCK) m_fNumLockDown = false;
+}
@@ -0,0 +1,44 @@
+//++
+//escape.h - declarations for escape.c module
+//
+// Copyright (C) 2006-2024 by Spare Time Gizmos.  All rights reserved.
+//
+// This file is part of the Spare Time Gizmos' VT1802 and VIS1802 firmware.
+//
+// This firmware is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+// Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//REVISION HISTORY:
+// dd-mmm-yy    who     description
+// 16-Oct-26	RLA	New file.
+// 16-Oct-26	RLA	Add ReleaseKey().
+//--
+#pragma once
+
+// Special key modes (see escape.c) ...
+#define KEYMODE_CODES	0	// special keys send single 0x80..0xAF codes
+#define KEYMODE_VT52	1	// special keys send VT52 escape sequences
+#define KEYMODE_VT100	2	//   "     "    "   VT100   "        "
+#define KEYMODE_ANSI	3	//   "     "    "   ANSI (xterm) sequences
+#define KEYMODE_COUNT	4	// number of key modes
+
+// The default mode (this is normally set by the Makefile) ...
+#ifndef KEY_MODE
+#define KEY_MODE	KEYMODE_CODES
+#endif
+
+// Function prototypes...
+extern void SelectKeyMode (uint8_t bMode);
+extern void SendKey (uint8_t bCode);
+extern void ReleaseKey (uint8_t bCode);
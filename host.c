@@ -44,8 +44,23 @@
 // firmware to implement setup mode, local menus, run the built in BASIC,
 // send an RS-232 long break, etc ...
 //
+//   Alternatively, escape.c can translate the special keys into complete
+// VT52, VT100 or ANSI escape sequences right here.  The KEY_MODE option picks
+// the mode at startup and CONTROL+ALT+F9..F12 changes it.  In those modes the
+// NUM LOCK key switches the numeric keypad to application mode.
+//
+//   The keyboard layout tables hold ISO 8859-1 (Latin-1) characters, so the
+// national layouts can have the real accented letters.  The CHARSET option
+// decides how those are sent - as the old ISO 646 seven bit national codes,
+// as KEY_LATIN1 followed by seven bits, or as UTF-8.  CAPS LOCK works on the
+// Latin-1 letters too.
+//
 //   The right CTRL (if your keyboard has one), ALT keys (both left and right),
-// and NUMLOCK key do nothing.
+// and NUMLOCK key do nothing by themselves.
+//
+//   If the firmware was built with more than one keyboard layout then the
+// ALTERNATE_LAYOUT jumper selects the second layout at startup, and typing
+// CONTROL+ALT+Fn (which is not sent to the host) selects the n'th layout.
 //
 //   The current hardware and also keyboard.asm implement one way communication
 // only with the keyboard, and so the keyboard LEDs are not used, including the
@@ -70,21 +85,57 @@
 //			  SWAP_CAPSLOCK_AND_CONTROL remains.
 // 29-SEP-24	RLA	Invert the sense of the LED - it's normally ON now, and
 //			  turns off when the buffer is full.
+// 16-Oct-26	RLA	Add runtime selection of multiple keyboard layouts.
+// 16-Oct-26	RLA	Compute the shift plane only when a modifier changes,
+//			  and read the SWAP_CAPSLOCK_AND_CONTROL jumper once.
+// 16-Oct-26	RLA	Send special keys thru SendKey() so that escape.c can
+//			  generate VT52/VT100/ANSI sequences for them.
+// 16-Oct-26	RLA	Add PassthroughKeys() for raw scan codes and events.
+// 16-Oct-26	RLA	Send to the host thru a FIFO drained by ServiceHost().
+// 16-Oct-26	RLA	Add HOST_TIMEOUT so that a dead host can't hang us.
+// 16-Oct-26	RLA	Throw away typematic repeats when the host is behind.
+// 16-Oct-26	RLA	Add the pulse mode strobe.
+// 16-Oct-26	RLA	Add HOST_UART.
+// 16-Oct-26	RLA	Add host latency statistics and SendReport().
+// 16-Oct-26	RLA	Send status codes for keyboard errors and resets.
+// 16-Oct-26	RLA	Add RELEASE_EVENTS.
+// 16-Oct-26	RLA	Send Latin-1 characters according to CHARSET.
+// 16-Oct-26	RLA	Use TRACEn() instead of DBGOUT().
+// 16-Oct-26	RLA	Add the TRACE_RING post-mortem trace.
+// 16-Oct-26	RLA	Add ERROR_STATS.
+// 16-Oct-26	RLA	Add IDLE_MODE.
+// 16-Oct-26	RLA	Add POWER_DOWN.
+// 16-Oct-26	RLA	Add the DEBUG_MONITOR.
+// 16-Oct-26	RLA	Add the software typematic (TYPEMATIC_DELAY).
+// 16-Oct-26	RLA	Add KEY_BITMAP and forget all keys after a resync.
+// 16-Oct-26	RLA	Start over after a BAT, even in the middle of a key.
+// 16-Oct-26	RLA	Trace the time of the first key after startup.
+// 16-Oct-26	RLA	Let each layout have its own ISO 646 codes.
+// 16-Oct-26	RLA	Tell escape.c when a special key is released.
+// 16-Oct-26	RLA	Don't send KEY_RELEASE for characters we can't send.
+// 16-Oct-26	RLA	HOST_HOLD goes back to the main loop instead of waiting.
+// 16-Oct-26	RLA	Time the typematic repeats with an unsigned compare.
+// 16-Oct-26	RLA	Trace the latency histogram too.
 //--
-#include <stdio.h>		// needed so DBGOUT(()) can find printf!
 #include <stdint.h>		// uint8_t, et al ...
 #include <stdbool.h>		// bool, true, false ...
 #include "at89x051.h"		// register definitions for the AT89C2051
 #include "ps2apu.h"		// definitions for this project
+#include "trace.h"		// TR_xxx trace event codes
 #include "debug.h"		// debuging (serial port output) routines
 #include "keyboard.h"		// low level keyboard serial I/O functions
 #include "scancode.h"		// PS2 scan codes to ASCII translation table
 #include "host.h"		// prototypes and options for this module
+#include "escape.h"		// SendKey() and VT52/VT100/ANSI key modes
 
-// These are simplified versions of islower() and toupper() from ctype.h ...
+//   These are simplified versions of islower() and toupper() from ctype.h,
+// except that they know about the Latin-1 lower case letters too (0xE0..0xFE,
+// except for the divide sign, 0xF7) ...
 #define toupper(c) ((c)&=0xDF)
-#define islower(c) ((unsigned char) c >= (unsigned char) 'a' \
-		 && (unsigned char) c <= (unsigned char) 'z')
+#define islower(c) (((unsigned char) c >= (unsigned char) 'a' \
+		 && (unsigned char) c <= (unsigned char) 'z') \
+		 || ((unsigned char) c >= 0xE0 && (unsigned char) c != 0xF7 \
+		 && (unsigned char) c != 0xFF))
 
 
 // Keyboard status bits ...
@@ -95,47 +146,745 @@ __bit __at 0x8	m_fLeftShiftDown;  //  -> left shift key is pressed now
 __bit __at 0x9	m_fRightShiftDown; //  -> right  "    "   "  "   "   "
 __bit __at 0xA	m_fControlDown;    //  -> control key     "  "   "   "
 __bit __at 0xB	m_fCapsLockOn;	   //  -> CAPS LOCK mode is on
+__bit __at 0xC	m_fAltDown;	   //  -> either ALT key is pressed now
+
+// Configuration flags (these are NOT part of m_bShiftFlags!) ...
+PRIVATE __bit m_fSwapCapsControl;  //  -> swap the CAPS LOCK and CONTROL keys
+
+//   This is the shift/control plane (the second index of g_abScanCodes[]) for
+// the current state of the SHIFT and CONTROL keys.  It's updated by DoShift()
+// only when one of those keys changes, so DoASCII() doesn't have to figure it
+// out again for every character.  m_abShiftPlanes[] is indexed by the low
+// three bits of m_bShiftFlags - left shift, right shift and control...
+PRIVATE uint8_t __data m_bShiftPlane;
+PRIVATE uint8_t const __code m_abShiftPlanes[8] = {0, 1, 1, 1, 2, 3, 3, 3};
+
+//   This is the last key that was pressed and not yet released (extended keys
+// have the 0x80 bit set) - if we see it pressed again, it's a typematic
+// repeat.  See IsRepeat() ...
+PRIVATE uint8_t __data m_bLastKey;
+
+//   This is set while ConvertKeys() or PassthroughKeys() is waiting for the
+// first byte of a key, and it's clear while they're waiting for the rest of
+// one (e.g. after an E0 or F0).  WaitKey() needs to know (see DoBAT()) ...
+PRIVATE __bit m_fBetweenKeys;
+
+// The DEBUG version traces the time of the first key after startup ...
+#ifdef DEBUG
+PRIVATE __bit m_fFirstKey;			// -> first key has been traced
+#endif
+
+//   KEY_BITMAP has one bit for every key that's down right now, indexed by
+// the same key codes as m_bLastKey (F7 and all the extended keys are above
+// 0x80, but there's no E0 03 to collide with F7).  m_abBitMasks[] saves a
+// shift loop, so every key costs the same ...
+#if KEY_BITMAP
+PRIVATE uint8_t __idata m_abKeysDown[256/8];	// one bit per key
+PRIVATE uint8_t const __code m_abBitMasks[8] = {
+  0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80
+};
+#endif
+
+//   With TYPEMATIC_DELAY we make our own repeats of m_bLastKey.  The repeat
+// is fed back thru WaitKey(), so it goes thru exactly the same code as a key
+// from the keyboard would, but only when ConvertKeys() is between keys (or we
+// might end up in the middle of somebody else's E0 sequence).  See NextRepeat()
+// for the rest ...
+#if TYPEMATIC_DELAY > 0
+PRIVATE uint16_t __data m_wRepeatTime;	// GetTicks() at the last press or repeat
+PRIVATE uint8_t __data m_bRepeatNext;	// second byte of an extended repeat
+PRIVATE __bit m_fRepeating;		// -> this key is one of our repeats
+PRIVATE __bit m_fRepeated;		// -> this key has repeated at least once
+// Keys that never repeat - modifiers and lock keys ...
+PRIVATE uint8_t const __code m_abNoRepeat[] = {
+  0x12, 0x59, 0x14, 0x94, 0x11, 0x91, 0x58, 0x77, 0x7E
+};
+#endif
+
+//   If there's more than one keyboard layout, this points to the delta rows
+// (see scancode.h) for the current one...
+#if LAYOUT_COUNT > 1
+PRIVATE uint8_t const __code * __data m_pbLayoutDeltas;
+#endif
+//   And this points to the ISO 646 codes (see scancode.h) for the current
+// layout.  With only one layout, it's always the same ...
+#if CHARSET == CHARSET_ISO646
+#if LAYOUT_COUNT > 1
+PRIVATE uint8_t const __code * __data m_pbLayoutISO646;
+#else
+#define m_pbLayoutISO646 (g_abLayoutISO646[0][0])
+#endif
+#endif
 
 
 //++
-//   This routine returns a scan code from the keyboard buffer.  If the
-// buffer is empty, it waits (forever if necessary) until one shows up.
+//   Bytes for the host go thru a small FIFO so that translation can run
+// ahead of a slow host, and multi byte escape sequences go out back to back
+// at whatever pace the host can manage.  SendHost() only puts a byte into the
+// FIFO, and ServiceHost() takes them out and does the handshake with the host.
+//
+//   It would be nice to do that with an interrupt, and KEY_DATA_RDY is even
+// wired to the INT1 pin, but the 8051 can only interrupt on a falling edge or
+// a low level.  KEY_DATA_RDY goes low when WE set it, and it's the rising edge
+// when the host reads the byte that we care about.  So ServiceHost() is polled
+// instead - WaitKey() calls it while the keyboard buffer is empty, and so does
+// SendHost() whenever the FIFO is full.
+//
+//   Some hosts latch the data on the strobe edge and don't need the whole
+// handshake.  For them, STROBE_PULSE selects pulse mode, where there's just a
+// short strobe pulse and then a minimum gap (STROBE_GAP) before the next one.
+//
+//   And some hosts have only a serial input.  For them HOST_UART sends the
+// keys thru the 8051 UART instead of P1.  The UART has its own interrupt, so
+// in that case HOST_SERIAL() empties the FIFO and ServiceHost() only has to
+// get it started.
 //--
-PRIVATE uint8_t WaitKey (void)
+PRIVATE uint8_t __data m_abHostBuffer[HOSTBUFLEN];// bytes waiting for the host
+PRIVATE volatile uint8_t __data m_bHostGet;	// FIFO "get" pointer
+PRIVATE uint8_t __data m_bHostPut;		//  "   "put"   "   "
+PRIVATE __bit m_fHostBusy;			// -> a byte is on P1 now
+#if STROBE_PULSE > 0
+PRIVATE uint8_t __data m_bPulseTime;		// TL0 at the end of the last pulse
+#endif
+
+//   If the host doesn't read the byte on P1 within HOST_TIMEOUT milliseconds
+// while the FIFO is full, then we assume that it's crashed, sitting in a ROM
+// monitor, or unplugged, and we do what HOST_POLICY says instead of waiting
+// forever.  Either way g_wHostTimeouts counts the bytes that were dropped (or,
+// for HOST_HOLD, the number of times we had to inhibit the keyboard).  While
+// the keyboard is held off, WaitKey() doesn't hand out any more keys, but it
+// still services the host and everything else ...
+#if (HOST_TIMEOUT > 0) || LATENCY_STATS
+PRIVATE uint16_t __data m_wHostTime;		// GetTicks() when P1 was loaded
+#endif
+#if HOST_TIMEOUT > 0
+PUBLIC uint16_t __data g_wHostTimeouts;		// count of host timeouts
+#if HOST_POLICY == HOST_HOLD
+PRIVATE __bit m_fKeyInhibit;			// -> keyboard is inhibited now
+#define HOST_HELD	m_fKeyInhibit
+#endif
+#endif
+#ifndef HOST_HELD
+#define HOST_HELD	false
+#endif
+
+//   LATENCY_STATS measures how long the host takes to read each byte, from
+// the time we assert the strobe until we see KEY_DATA_RDY go high, in machine
+// cycles.  That's limited to 65535 cycles, or about 55ms at 14.318MHz, and
+// anything longer counts as 65535.  It includes up to one trip around our own
+// polling loop, but that's only a few hundred cycles at most.  We keep -
+//
+//	g_wLatencyMin	   - the shortest time
+//	g_wLatencyMax	   - the longest time
+//	g_wLatencyMean	   - a running average, weighting each new time by 1/16
+//	g_abLatencyHistogram - a count of times in each bucket - bucket 0 is less
+//			   than 16 cycles, and each one after that is four times
+//			   wider than the one before, except that the last one
+//			   is everything that was too long to measure.  When any
+//			   count reaches 255 they're all halved, so the shape
+//			   stays the same.
+//
+// These can be read with the debugger, sent to the host by SendReport(), or
+// traced, histogram and all, by the debug monitor's "L" command.
+#if LATENCY_STATS
+PRIVATE uint16_t __data m_wLatencyStart;	// GetCycles() when P1 was loaded
+PUBLIC uint16_t __data g_wLatencyMin = 0xFFFF;	// shortest latency seen
+PUBLIC uint16_t __data g_wLatencyMax;		// longest	"	"
+PUBLIC uint16_t __data g_wLatencyMean;		// running average latency
+PUBLIC uint8_t __data g_abLatencyHistogram[LATENCY_BUCKETS];
+#endif
+
+//   TRACE_RING keeps a record of the last TRACE_RING raw bytes received from
+// the keyboard, keyboard errors, and bytes sent to the host, each with a six
+// bit time stamp (see host.h).  Recording one costs only a few cycles, so it
+// can be left on in production firmware, and CONTROL+ALT+SCROLL LOCK sends it
+// to the host (see SendReport()).  Host bytes are recorded when they go into
+// the FIFO, not when the host reads them.
+#if TRACE_RING > 0
+PRIVATE uint8_t __idata m_abTraceRing[TRACE_RING][2];// tag and data bytes
+PRIVATE uint8_t __data m_bTracePut;		// next entry to be written
+PRIVATE uint8_t __data m_bTraceCount;		// number of entries used
+PRIVATE __bit m_fTraceHold;			// -> don't record anything now
+#define RING_NOW	((LOBYTE(g_wTicks) >> 2) & RING_TIME)
+#define RECORD(t,d)	RecordTrace(t, d)
+#else
+#define RECORD(t,d)
+#endif
+
+//   ERROR_STATS keeps counts of every kind of keyboard error, of keyboard
+// resyncs, and of the bytes received from the keyboard and sent to the host,
+// so that bad cables and keyboards show up as a high error rate long before
+// anybody complains.  InitializeKeyboard() clears the error flags, so they're
+// counted in WaitKey() just before that.  The counts stick at their maximum
+// instead of wrapping around, and CONTROL+ALT+SCROLL LOCK sends them to the
+// host (see SendReport()).  Keyboard overflows count both our own buffer
+// overflowing and the keyboard reporting that its buffer overflowed.
+#if ERROR_STATS
+PUBLIC uint8_t __data g_bParityErrors;		// keyboard parity errors
+PUBLIC uint8_t __data g_bFramingErrors;		//  "   "  start/stop bit errors
+PUBLIC uint8_t __data g_bTimeoutErrors;		//  "   "  timeouts
+PUBLIC uint8_t __data g_bOverflows;		//  "   "  buffer overflows
+PUBLIC uint8_t __data g_bResyncs;		// keyboard receiver resets
+PUBLIC uint16_t __data g_wBytesReceived;	// bytes received from the keyboard
+PUBLIC uint16_t __data g_wBytesSent;		// bytes sent to the host
+#define COUNT(x)	{if (++(x) == 0) --(x);}
+#else
+#define COUNT(x)
+#endif
+
+// POWER_DOWN needs to know how long the keyboard has been quiet ...
+#if POWER_DOWN > 0
+PRIVATE uint16_t __data m_wLastKey;		// GetTicks() at the last key
+#endif
+
+#if TRACE_RING > 0
+//++
+//   Add an entry to the trace ring.  bType is one of the RING_xxx types ...
+//--
+PRIVATE void RecordTrace (uint8_t bType, uint8_t bData)
 {
-  int nKey;
-  while (true) {
-    if ((nKey = GetKey()) != -1) {
-      DBGOUT(("KBD: GetKey() returned 0x%x\n", nKey));
-      return LOBYTE(nKey);
-    }
-    if ((g_bKeyFlags & KEYBOARD_ERROR_BITS) != 0) {
-      DBGOUT(("KBD: Keyboard re-initialized (0x%x) !!\n", g_bKeyFlags));
-      InitializeKeyboard();
+  if (m_fTraceHold) return;
+  m_abTraceRing[m_bTracePut][0] = bType | RING_NOW;
+  m_abTraceRing[m_bTracePut][1] = bData;
+  m_bTracePut = (m_bTracePut+1) & (TRACE_RING-1);
+  if (m_bTraceCount < TRACE_RING) ++m_bTraceCount;
+}
+#endif
+
+
+#if LATENCY_STATS
+//++
+//   Update the latency statistics when the host reads a byte (see above) ...
+//--
+PRIVATE void RecordLatency (void)
+{
+  uint16_t wLatency = GetCycles() - m_wLatencyStart;
+  uint16_t w;  uint8_t i;
+  if ((uint16_t) (GetTicks() - m_wHostTime) >= 63) wLatency = 0xFFFF;
+  if (wLatency < g_wLatencyMin) g_wLatencyMin = wLatency;
+  if (wLatency > g_wLatencyMax) g_wLatencyMax = wLatency;
+  g_wLatencyMean = g_wLatencyMean - (g_wLatencyMean >> 4) + (wLatency >> 4);
+  if (wLatency == 0xFFFF)
+    i = LATENCY_BUCKETS-1;
+  else
+    for (i = 0, w = wLatency >> 4;  w != 0;  ++i)  w >>= 2;
+  if (++g_abLatencyHistogram[i] == 255) {
+    for (i = 0;  i < LATENCY_BUCKETS;  ++i)  g_abLatencyHistogram[i] >>= 1;
+  }
+}
+#endif
+
+
+//++
+//   Move the host FIFO along.  If the host has read the byte on P1 then finish
+// that handshake, and if P1 is free then put the next byte from the FIFO on
+// it.  This never waits for anything.
+//--
+#if HOST_UART
+PRIVATE void ServiceHost (void)
+{
+  //   If the transmitter is idle, then setting TI causes a serial interrupt
+  // and HOST_SERIAL() will do the rest.  If it's busy then it'll find any new
+  // bytes in the FIFO by itself ...
+  if (m_fHostBusy || (m_bHostGet == m_bHostPut)) return;
+  LED_OFF;  m_fHostBusy = true;  TI = 1;
+}
+
+
+//++
+//   This is the serial port interrupt for HOST_UART.  Every time the UART
+// finishes sending a byte it sends the next one from the FIFO, and when the
+// FIFO is empty it just stops.  Nothing is ever received, but RI has to be
+// cleared anyway or we'd be interrupted forever ...
+//--
+PUBLIC void HOST_SERIAL (void) __interrupt (4)
+{
+  RI = 0;
+  if (!TI) return;
+  TI = 0;
+  if (m_bHostGet == m_bHostPut) {
+    LED_ON;  m_fHostBusy = false;  return;
+  }
+  SBUF = m_abHostBuffer[m_bHostGet];
+  m_bHostGet = (m_bHostGet+1) & (HOSTBUFLEN-1);
+}
+#else
+PRIVATE void ServiceHost (void)
+{
+#if STROBE_PULSE > 0
+  //   In pulse mode the host doesn't tell us anything - just wait until the
+  // minimum gap since the last pulse has passed.  If we don't get called for
+  // more than 256 machine cycles TL0 may have wrapped around and we'll wait
+  // up to STROBE_GAP cycles longer than we have to, but that's harmless ...
+  if (m_fHostBusy) {
+    if ((uint8_t) (TL0 - m_bPulseTime) < STROBE_GAP) return;
+    LED_ON;  m_fHostBusy = false;
+  }
+#else
+  //   When the host reads the data it will reset the KEY DATA READY signal.
+  // When we see that happen, then turn on the LED and deassert the SET KEY
+  // DATA READY ...
+  if (m_fHostBusy) {
+    if (KEY_DATA_RDY == 0) return;
+    SET_KEY_DATA_RDY = !STROBE_ACT_LVL;  LED_ON;  m_fHostBusy = false;
+#if LATENCY_STATS
+    RecordLatency();
+#endif
+#if (HOST_TIMEOUT > 0) && (HOST_POLICY == HOST_HOLD)
+    // The host is alive again - let the keyboard go ...
+    if (m_fKeyInhibit) {
+      ReleaseKeyboard();  m_fKeyInhibit = false;
     }
+#endif
   }
+#endif
+
+  //   If there's anything in the FIFO, put it on the port pins, turn off the
+  // LED as an activity indicator, and then assert the KEY DATA READY strobe.
+  // In pulse mode the strobe is turned off again right away ...
+  if (m_bHostGet == m_bHostPut) return;
+  P1 = m_abHostBuffer[m_bHostGet];
+  TRACE1(TR_HOST, m_abHostBuffer[m_bHostGet]);
+  m_bHostGet = (m_bHostGet+1) & (HOSTBUFLEN-1);
+  LED_OFF;  SET_KEY_DATA_RDY = STROBE_ACT_LVL;  m_fHostBusy = true;
+#if STROBE_PULSE > 0
+  m_bPulseTime = TL0;
+  while ((uint8_t) (TL0 - m_bPulseTime) < STROBE_PULSE) ;
+  SET_KEY_DATA_RDY = !STROBE_ACT_LVL;  m_bPulseTime = TL0;
+#endif
+#if (HOST_TIMEOUT > 0) || LATENCY_STATS
+  m_wHostTime = GetTicks();
+#endif
+#if LATENCY_STATS
+  m_wLatencyStart = GetCycles();
+#endif
 }
+#endif
 
 
 //++
-//   This routine will send one ASCII character to the host CPU.  If the
-// buffer isn't free (because the host hasn't yet read the last character)
-// then it will wait (forever, if necessary) for the host.  
+//   This routine will send one ASCII character to the host CPU.  The byte is
+// just added to the host FIFO, and if the FIFO is full then it will wait for
+// the host to make room.  That's forever if HOST_TIMEOUT is zero, and if it
+// isn't then see above.
+//
+//   Note that when the FIFO is full the byte on P1 came from the slot that
+// m_bHostPut points to, and it's still there.  That's the one that HOST_DROP_
+// OLDEST throws away, since it's the one the host hasn't read.  Loading the
+// next byte onto P1 makes room in the FIFO and restarts the timeout, too.
 //--
 PUBLIC void SendHost (uint8_t ch)
 {
-  //   Put the new data on the port pins, turn off the LED as an activity
-  // indicator, and then assert the KEY DATA READY strobe...
-  P1 = ch;
-  LED_OFF;  SET_KEY_DATA_RDY = STROBE_ACT_LVL;
-  DBGOUT(("KBD: sending 0x%x to host\n", ch));
-
-  //   When the host reads the data it will reset the KEY DATA READY signel.
-  // When we see that happen, then we know it's OK to proceed ...
-  while (KEY_DATA_RDY == 0) ;
-
-  // Turn on the LED and deassert the SET KEY DATA READY ...
-  SET_KEY_DATA_RDY = !STROBE_ACT_LVL;  LED_ON;
+  uint8_t bNext = (m_bHostPut+1) & (HOSTBUFLEN-1);
+  while (bNext == m_bHostGet) {
+    ServiceHost();
+#if IDLE_MODE && HOST_UART
+    //   With HOST_UART the serial interrupt will make room in the FIFO, so
+    // just wait for that ...
+    IDLE;
+#endif
+#if HOST_TIMEOUT > 0
+    //   If the FIFO is full then there's always a byte on P1, so just check
+    // how long it's been there ...
+    if ((uint16_t) (GetTicks() - m_wHostTime) < MS_TO_TICKS(HOST_TIMEOUT))
+      continue;
+#if HOST_POLICY == HOST_DROP_NEWEST
+    TRACE1(TR_HOST_DROP, ch);  RECORD(RING_DROP, ch);
+    ++g_wHostTimeouts;  return;
+#elif HOST_POLICY == HOST_DROP_OLDEST
+    TRACE1(TR_HOST_DROP, m_abHostBuffer[m_bHostPut]);
+    RECORD(RING_DROP, m_abHostBuffer[m_bHostPut]);
+    ++g_wHostTimeouts;
+    SET_KEY_DATA_RDY = !STROBE_ACT_LVL;  m_fHostBusy = false;
+    ServiceHost();
+#else
+    //   Hold the keyboard off until the host is back and go back to the main
+    // loop.  The keyboard keeps any more keys until then, but this byte (and
+    // the rest of the same key) has nowhere to go and is dropped ...
+    if (!m_fKeyInhibit) {
+      TRACE0(TR_HOST_HOLD);
+      ++g_wHostTimeouts;  InhibitKeyboard();  m_fKeyInhibit = true;
+    }
+    TRACE1(TR_HOST_DROP, ch);  RECORD(RING_DROP, ch);  return;
+#endif
+#endif
+  }
+  m_abHostBuffer[m_bHostPut] = ch;  m_bHostPut = bNext;
+  RECORD(RING_HOST, ch);  COUNT(g_wBytesSent);
+  ServiceHost();
+}
+
+
+//++
+//   This routine returns TRUE if this key is a typematic repeat that should be
+// thrown away.  A repeat is the same key pressed again without being released
+// first, and we only throw it away if the host is already REPEAT_BACKLOG or
+// more bytes behind.  Otherwise holding down an arrow key or BACKSPACE on a
+// slow host keeps on going for seconds after the key is released.  Throwing
+// away the whole key, rather than bytes, means that escape sequences are never
+// broken up.  This is called for every key, so it can keep track ...
+//
+//   The keyboard only repeats the last key pressed, and only until that key
+// is released, so releasing some other key doesn't change anything.  With
+// TYPEMATIC_DELAY the keyboard's repeats are always thrown away, and ours
+// always go thru.
+//
+//   With KEY_BITMAP, any key that's pressed again while it's already down is
+// a repeat, whether it's the last key or not, and a release for a key that
+// isn't down (e.g. one that was pressed before a resync) is thrown away too.
+//--
+PRIVATE bool IsRepeat (uint8_t bKey, bool fRelease)
+{
+#if KEY_BITMAP
+  uint8_t __idata *pbKeys = &m_abKeysDown[bKey >> 3];
+  uint8_t bMask = m_abBitMasks[bKey & 7];
+  bool fDown = (*pbKeys & bMask) != 0;
+#endif
+  if (fRelease) {
+    if (bKey == m_bLastKey) m_bLastKey = 0;
+#if KEY_BITMAP
+    if (!fDown) {
+      TRACE1(TR_STRAY_RELEASE, bKey);  return true;
+    }
+    *pbKeys &= ~bMask;
+#endif
+    return false;
+  }
+#if TYPEMATIC_DELAY > 0
+  if (m_fRepeating) {
+    m_fRepeating = false;  return false;
+  }
+#endif
+#if KEY_BITMAP
+  *pbKeys |= bMask;
+  if (!fDown) {
+#else
+  if (bKey != m_bLastKey) {
+#endif
+    m_bLastKey = bKey;
+#if TYPEMATIC_DELAY > 0
+    m_wRepeatTime = GetTicks();  m_fRepeated = false;
+#endif
+    return false;
+  }
+#if TYPEMATIC_DELAY > 0
+  return true;
+#else
+#if REPEAT_BACKLOG > 0
+  if (((m_bHostPut - m_bHostGet) & (HOSTBUFLEN-1)) >= REPEAT_BACKLOG) {
+    TRACE1(TR_REPEAT, bKey);  return true;
+  }
+#endif
+  return false;
+#endif
+}
+
+
+//++
+//   Status codes (KEY_OVERFLOW, KEY_RESYNC, etc) are only sent to the host
+// when we're translating keys.  In the PASSTHROUGH modes they'd look just like
+// scan codes or key events ...
+//--
+#if PASSTHROUGH == 0
+#define SendStatus(b)	SendHost(b)
+#else
+#define SendStatus(b)
+#endif
+
+
+#if POWER_DOWN > 0
+//++
+//   This routine powers down the CPU until the keyboard wakes it up again.
+// The oscillator takes a while to get going again, and the keyboard doesn't
+// wait for it, so we can never receive the byte that wakes us up.  Instead
+// the WAKE state in keyboard.asm inhibits the keyboard as soon as the ISR
+// runs, and if that's before the keyboard's tenth clock then the keyboard
+// gives up on that byte and sends it again later.  It also has to see the
+// clock low for at least 100us, so we hold it for at least one whole tick
+// before letting the keyboard go.
+//
+//   The wake up time is the oscillator start up time (anything from a few
+// hundred microseconds for a ceramic resonator to several milliseconds for
+// some crystals - check the data sheet!) plus a dozen or so machine cycles
+// for the ISR.  A byte from the keyboard takes between 660us and 1.1ms, so
+// only a fast starting oscillator gets there in time.  If it's slower then
+// every byte the keyboard finishes before we inhibit it is lost - roughly one
+// per millisecond of start up time - but that's only ever the first key press
+// (one or two bytes, unless it's PRINT SCREEN or PAUSE).  Nothing is at risk
+// before that, since we only power down when everything has been sent to the
+// host.  The keyboard is never quiet for long while a key is held down, so as
+// long as POWER_DOWN is longer than the typematic delay we never lose a
+// release.
+//
+//   The LED is on whenever we're waiting for a key, and it probably uses more
+// current than everything else put together, so it's off while we're powered
+// down.
+//--
+PRIVATE void Sleep (void)
+{
+  uint16_t wStart;
+  LED_OFF;
+  if (PowerDown()) {
+    wStart = GetTicks();
+    while ((GetTicks() - wStart) < 2) ;
+    InitializeKeyboard();
+  }
+  LED_ON;  m_wLastKey = GetTicks();
+}
+#endif
+
+
+//++
+//   This routine forgets about all the keys that are down.  It's called
+// whenever we might have missed a release - after a keyboard resync or a
+// keyboard overflow - so that SHIFT, CONTROL or ALT can't get stuck down until
+// they're pressed again.  If one of them really is still down then the user
+// has to press it again, but that's a lot less surprising than a stuck key.
+// CAPS LOCK isn't a key that's down, it's a mode, so it's left alone ...
+//--
+PRIVATE void ForgetKeys (void)
+{
+#if KEY_BITMAP
+  uint8_t i;
+  for (i = 0;  i < sizeof(m_abKeysDown);  ++i)  m_abKeysDown[i] = 0;
+#endif
+  m_fLeftShiftDown = m_fRightShiftDown = m_fControlDown = m_fAltDown = false;
+  m_bShiftPlane = 0;  m_bLastKey = 0;
+}
+
+
+#if TYPEMATIC_DELAY > 0
+//++
+//   This routine returns the first byte of a typematic repeat of m_bLastKey
+// if one is due now, or -1 if not.  The next one is due TYPEMATIC_RATE after
+// this one goes out, rather than after this one was due, and nothing goes out
+// until the host FIFO is empty - so if the host can't keep up, the repeat rate
+// just slows down to whatever it can take, and nothing piles up to keep on
+// going after the key is released.  The time since the last press or repeat
+// is compared unsigned, so the delay can be anything up to 65535 ticks.
+//
+//   Extended keys are in m_bLastKey with the 0x80 bit set, so this returns the
+// E0 prefix and leaves the rest in m_bRepeatNext for WaitKey().  F7 (0x83) is
+// the only ordinary scan code that has the 0x80 bit set already!
+//--
+PRIVATE int NextRepeat (void)
+{
+  uint8_t i;
+  if (m_bLastKey == 0) return -1;
+  if ((uint16_t) (GetTicks() - m_wRepeatTime) < (m_fRepeated
+      ? MS_TO_TICKS(TYPEMATIC_RATE) : MS_TO_TICKS(TYPEMATIC_DELAY))) return -1;
+  if (m_bHostGet != m_bHostPut) return -1;
+  for (i = 0;  i < sizeof(m_abNoRepeat);  ++i)
+    if (m_abNoRepeat[i] == m_bLastKey) return -1;
+  m_wRepeatTime = GetTicks();  m_fRepeated = m_fRepeating = true;
+  if (((m_bLastKey & 0x80) != 0) && (m_bLastKey != 0x83)) {
+    m_bRepeatNext = m_bLastKey & 0x7F;  return 0xE0;
+  }
+  return m_bLastKey;
+}
+#endif
+
+
+#if defined(DEBUG) && DEBUG_MONITOR
+//++
+//   This is a (very!) little command monitor on the debug serial port.  Each
+// command is a single character, and the replies are trace records so that
+// ps2trace can decode them along with everything else -
+//
+//	T - send the tick count (TR_TICKS)
+//	E - send the error and byte counts (ERROR_STATS) and debug drops
+//	R - send the tick count and then the trace ring (TRACE_RING), oldest first
+//	L - send the host latency statistics (LATENCY_STATS), and then the
+//	    count in each histogram bucket (TR_LAT_BUCKET)
+//	I - followed by a count and that many bytes, which are injected into the
+//	    keyboard buffer (this one is handled by DEBUG_SERIAL() in debug.c)
+//
+//   To measure throughput, send "TE", a bunch of "I" commands, and then "TE"
+// again - the difference in TR_TX_BYTES over the difference in TR_TICKS is the
+// rate.  Injected bytes are just like the real thing, so if they come faster
+// than the host can take them then the keyboard buffer overflows, and that
+// gets reported and counted too.
+//
+//   The replies wait for room in the debug buffer, so a long reply holds up
+// the keyboard for a while.  Don't ask for the trace ring while you're typing!
+//--
+PRIVATE void Monitor (void)
+{
+#if (TRACE_RING > 0) || LATENCY_STATS
+  uint8_t i;
+#endif
+#if TRACE_RING > 0
+  uint8_t n;
+#endif
+  int c;  uint16_t wTicks;
+  if ((c = PollDebug()) == -1) return;
+  switch (c) {
+    case 'T':
+      wTicks = GetTicks();
+      TraceWait(TR_TICKS|TRACE_2BYTES, HIBYTE(wTicks), LOBYTE(wTicks));
+      break;
+
+    case 'E':
+#if ERROR_STATS
+      TraceWait(TR_ERR_PF|TRACE_2BYTES, g_bParityErrors, g_bFramingErrors);
+      TraceWait(TR_ERR_TO|TRACE_2BYTES, g_bTimeoutErrors, g_bOverflows);
+      TraceWait(TR_RESYNCS|TRACE_1BYTE, g_bResyncs, 0);
+      TraceWait(TR_RX_BYTES|TRACE_2BYTES,
+                HIBYTE(g_wBytesReceived), LOBYTE(g_wBytesReceived));
+      TraceWait(TR_TX_BYTES|TRACE_2BYTES,
+                HIBYTE(g_wBytesSent), LOBYTE(g_wBytesSent));
+#endif
+      TraceWait(TR_DROPS|TRACE_2BYTES,
+                HIBYTE(g_wDebugDrops), LOBYTE(g_wDebugDrops));
+      break;
+
+#if TRACE_RING > 0
+    case 'R':
+      m_fTraceHold = true;  wTicks = GetTicks();
+      TraceWait(TR_TICKS|TRACE_2BYTES, HIBYTE(wTicks), LOBYTE(wTicks));
+      i = (m_bTracePut - m_bTraceCount) & (TRACE_RING-1);
+      for (n = m_bTraceCount;  n != 0;  --n) {
+        TraceWait(TR_RING|TRACE_2BYTES,
+                  m_abTraceRing[i][0], m_abTraceRing[i][1]);
+        i = (i+1) & (TRACE_RING-1);
+      }
+      m_fTraceHold = false;
+      break;
+#endif
+
+#if LATENCY_STATS
+    case 'L':
+      TraceWait(TR_LAT_MIN|TRACE_2BYTES,
+                HIBYTE(g_wLatencyMin), LOBYTE(g_wLatencyMin));
+      TraceWait(TR_LAT_MEAN|TRACE_2BYTES,
+                HIBYTE(g_wLatencyMean), LOBYTE(g_wLatencyMean));
+      TraceWait(TR_LAT_MAX|TRACE_2BYTES,
+                HIBYTE(g_wLatencyMax), LOBYTE(g_wLatencyMax));
+      for (i = 0;  i < LATENCY_BUCKETS;  ++i)
+        TraceWait(TR_LAT_BUCKET|TRACE_2BYTES, i, g_abLatencyHistogram[i]);
+      break;
+#endif
+
+    default:
+      TraceWait(TR_BAD_COMMAND|TRACE_1BYTE, LOBYTE(c), 0);
+      break;
+  }
+}
+#define MONITOR	Monitor()
+#else
+#define MONITOR
+#endif
+
+
+//++
+//   The keyboard sends a BAT (0xAA, self test passed) whenever it's powered
+// up, and that includes being plugged in.  Whatever was down before is up now,
+// so forget all the keys and tell the host.  We never send the keyboard
+// anything (we can't - this hardware only listens) so there's no configuration
+// to restore - a new keyboard starts in scan set 2 with the default typematic
+// rate and the LEDs off, and that's just what we expect anyway.  CAPS LOCK is
+// our mode, not the keyboard's, so it stays the way it was.
+//
+//   Normally DoSpecial() calls this, but if the keyboard is plugged in while
+// we're in the middle of a key then WaitKey() does it instead (see there).
+//--
+PRIVATE void DoBAT (void)
+{
+  ForgetKeys();  SendStatus(KEY_BAT);
+}
+
+
+//++
+//   This routine returns a scan code from the keyboard buffer.  If the
+// buffer is empty, it waits (forever if necessary) until one shows up, and
+// keeps the host FIFO moving while it waits.  If the keyboard receiver has
+// reported an error then it's reset, which throws away anything still in the
+// buffer, and the host is told about it.  While HOST_HOLD has the keyboard
+// held off (see SendHost()) it doesn't return any keys at all.
+//
+//   With IDLE_MODE, when there's nothing to do the CPU idles until the next
+// interrupt instead of spinning.  The keyboard clock (INT0) and the timer 0
+// tick (every 1024 machine cycles) always wake it up, and so does the UART
+// in the DEBUG and HOST_UART versions.  The host acknowledge can't wake us up
+// (see ServiceHost()) so we never idle while a byte is waiting on P1 - if we
+// did, then every byte would take up to a whole tick longer.  There's a race
+// here - a byte can arrive after GetKey() looks and before we idle - but it
+// just means that byte waits for the next interrupt, one tick at most, and the
+// next keyboard clock edge usually comes long before that.
+//
+//   With POWER_DOWN, when the keyboard has been quiet for that long and
+// there's nothing left for the host, then we power down instead (see Sleep()).
+// And the DEBUG version checks for monitor commands here (see Monitor()).
+//
+//   A BAT can't be part of any key, so if one shows up when we're waiting for
+// the rest of a key then the keyboard was unplugged (or reset) in the middle
+// of it, and the rest is never coming.  We handle the BAT right here and
+// return 0x00 instead, which every caller either treats as an unknown key or
+// just gives up on, so we're back between keys right away.  The raw
+// PASSTHROUGH mode is always between keys, so it never sees this.
+//
+//   With TYPEMATIC_DELAY, this is also where our own repeats come from (see
+// NextRepeat()) ...
+//--
+PRIVATE uint8_t WaitKey (void)
+{
+  int nKey;  uint8_t bStatus;
+#ifdef DEBUG
+  uint16_t wTicks;
+#endif
+#if TYPEMATIC_DELAY > 0
+  if (m_bRepeatNext != 0) {
+    bStatus = m_bRepeatNext;  m_bRepeatNext = 0;  return bStatus;
+  }
+#endif
+  while (true) {
+    if (!HOST_HELD && ((nKey = GetKey()) != -1)) {
+#ifdef DEBUG
+      if (!m_fFirstKey) {
+        m_fFirstKey = true;  wTicks = GetTicks();
+        TRACE2(TR_FIRST_KEY, HIBYTE(wTicks), LOBYTE(wTicks));
+      }
+#endif
+      TRACE1(TR_KEY, LOBYTE(nKey));  RECORD(RING_KEY, LOBYTE(nKey));
+      COUNT(g_wBytesReceived);
+#if POWER_DOWN > 0
+      m_wLastKey = GetTicks();
+#endif
+      if ((LOBYTE(nKey) == 0xAA) && !m_fBetweenKeys) {
+        DoBAT();  return 0;
+      }
+      return LOBYTE(nKey);
+    }
+    ServiceHost();  MONITOR;
+#if TYPEMATIC_DELAY > 0
+    if (m_fBetweenKeys && !HOST_HELD && ((nKey = NextRepeat()) != -1))
+      return LOBYTE(nKey);
+#endif
+    if ((g_bKeyFlags & KEYBOARD_ERROR_BITS) != 0) {
+      TRACE1(TR_RESYNC, g_bKeyFlags);  RECORD(RING_ERROR, g_bKeyFlags);
+#if ERROR_STATS
+      if (g_bKeyFlags & KEYBOARD_PARITY)   COUNT(g_bParityErrors);
+      if (g_bKeyFlags & KEYBOARD_FRAMING)  COUNT(g_bFramingErrors);
+      if (g_bKeyFlags & KEYBOARD_TIMEOUT)  COUNT(g_bTimeoutErrors);
+      if (g_bKeyFlags & KEYBOARD_OVERFLOW) COUNT(g_bOverflows);
+      COUNT(g_bResyncs);
+#endif
+      bStatus = (g_bKeyFlags & KEYBOARD_OVERFLOW) ? KEY_OVERFLOW : KEY_RESYNC;
+      InitializeKeyboard();  ForgetKeys();
+      SendStatus(bStatus);
+    }
+#if POWER_DOWN > 0
+    if (!m_fHostBusy && (m_bHostGet == m_bHostPut)
+     && ((GetTicks() - m_wLastKey) >= MS_TO_TICKS(POWER_DOWN)))  Sleep();
+#endif
+#if IDLE_MODE
+#if HOST_UART
+    IDLE;
+#else
+    if (!m_fHostBusy) IDLE;
+#endif
+#endif
+  }
 }
 
 
@@ -160,23 +909,53 @@ PUBLIC void SendHost (uint8_t ch)
 //   This routine handles "special" key codes, such as 0xAA ("Self Test Pass"),
 // 0xFF ("Error") and so on.  It will return TRUE if it processes the key and
 // FALSE if the key code is not one of the "special" ones.  Note that these
-// messages never have a release or extended byte associated with them!
+// messages never have a release or extended byte associated with them!  The
+// ones that mean something to the host are passed on as status codes.
 //--
 PRIVATE bool DoSpecial (uint8_t bKey)
 {
   switch (bKey) {
-    case 0xFA:  DBGOUT(("KBD: ACKNOWLEDGE\n"));		  break;
-    case 0xAA:  DBGOUT(("KBD: SELF TEST PASSED\n"));	  break;
-    case 0xEE:  DBGOUT(("KBD: ECHO\n"));		  break;
-    case 0xFE:  DBGOUT(("KBD: RESEND\n"));		  break;
-    case 0x00:  DBGOUT(("KBD: ERROR/OVERFLOW\n"));	  break;
-    case 0xFF:  DBGOUT(("KBD: ERROR/OVERFLOW\n"));	  break;
+    case 0xFA:					// ACKNOWLEDGE
+    case 0xEE:					// ECHO
+    case 0xFE:					// RESEND
+      break;
+    case 0xAA:					// SELF TEST PASSED
+      DoBAT();  break;
+    case 0xFC:					// SELF TEST FAILED
+      SendStatus(KEY_KBD_ERROR);  break;
+    case 0x00:					// ERROR/OVERFLOW
+    case 0xFF:
+      COUNT(g_bOverflows);  ForgetKeys();
+      SendStatus(KEY_OVERFLOW);  break;
     default: return false;
   }
+  TRACE1(TR_REPLY, bKey);
   return true;
 }
 
 
+//++
+//   Send a special key to the host when it's pressed.  With RELEASE_EVENTS,
+// send KEY_RELEASE followed by the same code when it's released, too.  Note
+// that releases always send the plain key code, even in the VT52/VT100/ANSI
+// key modes, and the release of a printing key sends its unshifted character
+// (e.g. "a" is sent for the release of "A" or CONTROL-A).  Either way
+// escape.c hears about the release, so that it can tell a key that's held
+// down (and repeating) from one that's pressed again ...
+//--
+PRIVATE void SendKeyEvent (uint8_t bCode, bool fRelease)
+{
+  if (!fRelease) {
+    SendKey(bCode);
+  } else {
+    ReleaseKey(bCode);
+#if RELEASE_EVENTS
+    SendHost(KEY_RELEASE);  SendHost(bCode);
+#endif
+  }
+}
+
+
 //++
 //   This routine handles the various "shift" keys - left/right shift, left/
 // right control, caps lock, left/right alt, and the infamous "Windows" keys.
@@ -198,7 +977,7 @@ PRIVATE bool DoSpecial (uint8_t bKey)
 PRIVATE bool DoShift (uint8_t bKey, bool fRelease, bool fExtended)
 {
   // A small "hack" to swap the CAPS LOCK and CONTROL keys on the keyboard...
-  if (SWAP_CAPSLOCK_AND_CONTROL) {
+  if (m_fSwapCapsControl) {
     if (bKey == 0x58)
       bKey = 0x14;
     else if (bKey == 0x14)
@@ -207,28 +986,28 @@ PRIVATE bool DoShift (uint8_t bKey, bool fRelease, bool fExtended)
 
   switch (bKey) {
     // Left shift, right shift...
-    case 0x12:  m_fLeftShiftDown = !fRelease;  return true;
-    case 0x59:  m_fRightShiftDown = !fRelease;  return true;
+    case 0x12:  m_fLeftShiftDown = !fRelease;  break;
+    case 0x59:  m_fRightShiftDown = !fRelease;  break;
 
     // Control key...
     case 0x14:
       // The right control key is not currently implemented...
       if (fExtended) return false;
-      m_fControlDown = !fRelease;  return true;
+      m_fControlDown = !fRelease;  break;
 
     // CAPS LOCK key...
     case 0x58:  
-      if (fRelease) break;
+      if (fRelease) return false;
       m_fCapsLockOn = !m_fCapsLockOn;  return true;
 
-    // Alt key (ignored)...
-    case 0x11:  return true;
+    // Alt key (only used for CONTROL+ALT+Fn)...
+    case 0x11:  m_fAltDown = !fRelease;  return true;
 
     // Windows keys...
     case 0x1F:	// WINDOWS key (left)
     case 0x27:	// WINDOWS key (right)
       if (fExtended) {
-        if (!fRelease) DBGOUT(("KBD: Windows key pressed 0x%x\n", bKey));
+        if (!fRelease) TRACE1(TR_WINDOWS, bKey);
       }
       return false;
 
@@ -237,9 +1016,9 @@ PRIVATE bool DoShift (uint8_t bKey, bool fRelease, bool fExtended)
       return false;
   }
 
-  //   We can never get here, but SDCC isn't smart enough to figure that out
-  // so we need this to keep SDCC from complaining...
-  return false;
+  // Here if a SHIFT or CONTROL key changed - update the shift plane ...
+  m_bShiftPlane = m_abShiftPlanes[m_bShiftFlags & 7];
+  return true;
 }
 
 
@@ -253,46 +1032,46 @@ PRIVATE bool DoKeypad (uint8_t bKey, bool fRelease)
 {
   switch (bKey) {
     case 0x70:	// "0"
-      if (!fRelease) SendHost(KEY_KP0);
+      SendKeyEvent(KEY_KP0, fRelease);
       return true;
     case 0x69:	// "1"
-      if (!fRelease) SendHost(KEY_KP1);
+      SendKeyEvent(KEY_KP1, fRelease);
       return true;
     case 0x72:	// "2"
-      if (!fRelease) SendHost(KEY_KP2);
+      SendKeyEvent(KEY_KP2, fRelease);
       return true;
     case 0x7A:	// "3"
-      if (!fRelease) SendHost(KEY_KP3);
+      SendKeyEvent(KEY_KP3, fRelease);
       return true;
     case 0x6B:	// "4"
-      if (!fRelease) SendHost(KEY_KP4);
+      SendKeyEvent(KEY_KP4, fRelease);
       return true;
     case 0x73:	// "5"
-      if (!fRelease) SendHost(KEY_KP5);
+      SendKeyEvent(KEY_KP5, fRelease);
       return true;
     case 0x74:	// "6"
-      if (!fRelease) SendHost(KEY_KP6);
+      SendKeyEvent(KEY_KP6, fRelease);
       return true;
     case 0x6C:	// "7"
-      if (!fRelease) SendHost(KEY_KP7);
+      SendKeyEvent(KEY_KP7, fRelease);
       return true;
     case 0x75:	// "8"
-      if (!fRelease) SendHost(KEY_KP8);
+      SendKeyEvent(KEY_KP8, fRelease);
       return true;
     case 0x7D:	// "9"
-      if (!fRelease) SendHost(KEY_KP9);
+      SendKeyEvent(KEY_KP9, fRelease);
       return true;
     case 0x71:	// "."
-      if (!fRelease) SendHost(KEY_KPDOT);
+      SendKeyEvent(KEY_KPDOT, fRelease);
       return true;
     case 0x7C:	// "*"
-      if (!fRelease) SendHost(KEY_KPSTAR);
+      SendKeyEvent(KEY_KPSTAR, fRelease);
       return true;
     case 0x7B:	// "-"
-      if (!fRelease) SendHost(KEY_KPMINUS);
+      SendKeyEvent(KEY_KPMINUS, fRelease);
       return true;
     case 0x79:	// "+"
-      if (!fRelease) SendHost(KEY_KPPLUS);
+      SendKeyEvent(KEY_KPPLUS, fRelease);
       return true;
 
     // The NUM LOCK key is ignored ...
@@ -320,52 +1099,54 @@ PRIVATE bool DoKeypad (uint8_t bKey, bool fRelease)
 PRIVATE void DoExtended (void)
 {
   uint8_t bExtended = WaitKey();  bool fRelease = false;
+  if (bExtended == 0) return;		// keyboard was reset (see WaitKey())
   if (bExtended == 0xF0) {
     fRelease = true;  bExtended = WaitKey();
   }
+  if (IsRepeat(bExtended | 0x80, fRelease)) return;
 
   switch (bExtended) {
 
     // Arrow keys...
     case 0x75:	// UP ARROW
-      if (!fRelease) SendHost(KEY_UP);
+      SendKeyEvent(KEY_UP, fRelease);
       break;
     case 0x72:	// DOWN ARROW
-      if (!fRelease) SendHost(KEY_DOWN);
+      SendKeyEvent(KEY_DOWN, fRelease);
       break;
     case 0x74:	// RIGHT ARROW
-      if (!fRelease) SendHost(KEY_RIGHT);
+      SendKeyEvent(KEY_RIGHT, fRelease);
       break;
     case 0x6B:	// LEFT ARROW
-      if (!fRelease) SendHost(KEY_LEFT);
+      SendKeyEvent(KEY_LEFT, fRelease);
       break;
 
     // Editing keys...
     case 0x69:	// END
-      if (!fRelease) SendHost(KEY_END);
+      SendKeyEvent(KEY_END, fRelease);
       break;
     case 0x6C:	// HOME
-      if (!fRelease) SendHost(KEY_HOME);
+      SendKeyEvent(KEY_HOME, fRelease);
       break;
     case 0x70:	// INSERT
-      if (!fRelease) SendHost(KEY_INSERT);
+      SendKeyEvent(KEY_INSERT, fRelease);
       break;
     case 0x71:	// DELETE
-      if (!fRelease) SendHost(KEY_DELETE);
+      SendKeyEvent(KEY_DELETE, fRelease);
       break;
     case 0x7A:	// PAGE DOWN
-      if (!fRelease) SendHost(KEY_PGDN);
+      SendKeyEvent(KEY_PGDN, fRelease);
       break;
     case 0x7D:	// PAGE UP
-      if (!fRelease) SendHost(KEY_PGUP);
+      SendKeyEvent(KEY_PGUP, fRelease);
       break;
 
     // Other keypad keys...
     case 0x5A:	// KEYPAD ENTER
-      if (!fRelease) SendHost(KEY_KPENTER);
+      SendKeyEvent(KEY_KPENTER, fRelease);
       break;
     case 0x4A: // KEYPAD "/"
-      if (!fRelease) SendHost(KEY_KPSLASH);
+      SendKeyEvent(KEY_KPSLASH, fRelease);
       break;
 
     // Right ALT and right CONTROL keys...
@@ -375,7 +1156,7 @@ PRIVATE void DoExtended (void)
 
     // MENU key ...
     case 0x2F:
-      if (!fRelease) SendHost(KEY_MENU);
+      SendKeyEvent(KEY_MENU, fRelease);
       break;
 
     // Windows keys...
@@ -389,37 +1170,72 @@ PRIVATE void DoExtended (void)
     // like two keys that are both ignored!  BTW, when it's released, PRINT
     // SCREEN sends E0 F0 12 and then E0 F0 7C (which is what you'd expect).
     case 0x12:  case 0x7C:
-      if (!fRelease) DBGOUT(("KBD: PRINT SCREEN pressed 0x%x\n", bExtended));
+      if (!fRelease) TRACE1(TR_PRTSC, bExtended);
       break;
 
     default:
-      DBGOUT(("KBD: unknown extended key code E0 0x%x\n", bExtended));
+      TRACE1(TR_UNKNOWN_E0, bExtended);
   }
 }
 
 
+#if LAYOUT_COUNT > 1
+//++
+//   Select one of the keyboard layouts.  Out of range layout numbers are
+// ignored, and the layout doesn't change.
+//--
+PRIVATE void SelectLayout (uint8_t bLayout)
+{
+  if (bLayout >= LAYOUT_COUNT) return;
+  TRACE1(TR_LAYOUT, bLayout);
+  m_pbLayoutDeltas = g_apbLayoutDeltas[bLayout];
+#if CHARSET == CHARSET_ISO646
+  m_pbLayoutISO646 = g_abLayoutISO646[bLayout][0];
+#endif
+}
+#endif
+
+
 //++
-// Handle the function (F1..F12) keys...  All are currently ignored...
+//   Handle the function (F1..F12) keys...  These normally just send the
+// KEY_Fn code to the host, but CONTROL+ALT+Fn is used to select keyboard
+// layouts or the key mode instead.
 //--
 PRIVATE bool DoFunction (uint8_t bKey, bool fRelease)
 {
+  uint8_t bCode;
   switch (bKey) {
-    // Function keys F1..F12 (all are currently ignored).
-    case 0x05:  if (!fRelease) SendHost(KEY_F1);   return true;  // F1
-    case 0x06:  if (!fRelease) SendHost(KEY_F2);   return true;  // F2
-    case 0x04:  if (!fRelease) SendHost(KEY_F3);   return true;  // F3
-    case 0x0C:  if (!fRelease) SendHost(KEY_F4);   return true;  // F4
-    case 0x03:  if (!fRelease) SendHost(KEY_F5);   return true;  // F5
-    case 0x0B:  if (!fRelease) SendHost(KEY_F6);   return true;  // F6
-    case 0x83:  if (!fRelease) SendHost(KEY_F7);   return true;  // F7
-    case 0x0A:  if (!fRelease) SendHost(KEY_F8);   return true;  // F8
-    case 0x01:  if (!fRelease) SendHost(KEY_F9);   return true;  // F9
-    case 0x09:  if (!fRelease) SendHost(KEY_F10);  return true;  // F10
-    case 0x78:  if (!fRelease) SendHost(KEY_F11);  return true;  // F11
-    case 0x07:  if (!fRelease) SendHost(KEY_F12);  return true;  // F12
+    case 0x05:  bCode = KEY_F1;   break;  // F1
+    case 0x06:  bCode = KEY_F2;   break;  // F2
+    case 0x04:  bCode = KEY_F3;   break;  // F3
+    case 0x0C:  bCode = KEY_F4;   break;  // F4
+    case 0x03:  bCode = KEY_F5;   break;  // F5
+    case 0x0B:  bCode = KEY_F6;   break;  // F6
+    case 0x83:  bCode = KEY_F7;   break;  // F7
+    case 0x0A:  bCode = KEY_F8;   break;  // F8
+    case 0x01:  bCode = KEY_F9;   break;  // F9
+    case 0x09:  bCode = KEY_F10;  break;  // F10
+    case 0x78:  bCode = KEY_F11;  break;  // F11
+    case 0x07:  bCode = KEY_F12;  break;  // F12
     default:
       return false;
   }
+  if (fRelease) {
+    SendKeyEvent(bCode, true);  return true;
+  }
+  if (m_fControlDown && m_fAltDown) {
+    //   CONTROL+ALT+F9..F12 select the key mode, and CONTROL+ALT+F1..F8
+    // select one of the keyboard layouts ...
+    if (bCode >= KEY_F9)
+      SelectKeyMode(bCode - KEY_F9);
+#if LAYOUT_COUNT > 1
+    else
+      SelectLayout(bCode - KEY_F1);
+#endif
+    return true;
+  }
+  SendKey(bCode);
+  return true;
 }
 
 
@@ -429,21 +1245,212 @@ PRIVATE bool DoFunction (uint8_t bKey, bool fRelease)
 // ASCII code to the serial port, and if it's unsuccessful it returns FALSE.
 // Note that the ASCII code generated depends on some of the m_bShiftFlags
 // (e.g. shift, control, caps lock) flags.  Also note that ASCII keys only care
-// about the down event and never the release, so ASCII characters are sent
-// to the host only if fRelease == FALSE;
+// about the down event, so ASCII characters are sent to the host only if
+// fRelease == FALSE (unless RELEASE_EVENTS is on).  LookupASCII() just gets
+// the character from the table for the current layout...
 //--
+PRIVATE uint8_t LookupASCII (uint8_t bKey, uint8_t bShift)
+{
+  uint8_t bASCII = g_abScanCodes[bKey][bShift];
+#if LAYOUT_COUNT > 1
+  //   If this key is different in each layout, then look up the real character
+  // in the delta table.  Keys that are the same in every layout (which is
+  // almost all of them) pay only for this one compare...
+  if ((uint8_t) (bASCII - LAYOUT_DELTA) < MAXDELTAS)
+    bASCII = m_pbLayoutDeltas[((bASCII - LAYOUT_DELTA) << 2) + bShift];
+#endif
+  return bASCII;
+}
+
+#if CHARSET == CHARSET_ISO646
+//   ISO 646 national replacements for the Latin-1 characters used by our
+// layouts, as pairs of the Latin-1 character and its seven bit code.  The
+// same seven bit code means different things in different national variants
+// (e.g. "{" is a umlaut in German and Swedish, but ae in Danish and Norwegian)
+// so there's no ambiguity as long as each layout is used with its own variant.
+// Characters that only one variant has (e.g. the section sign, which is "@"
+// in German but doesn't exist in Swedish) are in that layout's own
+// g_abLayoutISO646[] entry instead.  Anything else isn't sent at all ...
+PRIVATE uint8_t const __code m_abISO646[][2] = {
+  {0xA3, '#'},	{0xA4, '$'},	{0xC4, '['},	{0xC5, ']'},	// £ ¤ Ä Å
+  {0xC6, '['},	{0xD6, '\\'},	{0xD8, '\\'},	{0xDC, ']'},	// Æ Ö Ø Ü
+  {0xDF, '~'},	{0xE4, '{'},	{0xE5, '}'},	{0xE6, '{'},	// ß ä å æ
+  {0xF6, '|'},	{0xF8, '|'},	{0xFC, '}'},			// ö ø ü
+};
+
+//++
+//   Return the ISO 646 code for a Latin-1 character in the current layout, or
+// zero if there isn't one.  The layout's own codes come first ...
+//--
+PRIVATE uint8_t ToISO646 (uint8_t bChar)
+{
+  uint8_t i;
+  for (i = 0;  i < 2*LAYOUT_ISO646;  i += 2) {
+    if (m_pbLayoutISO646[i] == bChar) return m_pbLayoutISO646[i+1];
+  }
+  for (i = 0;  i < sizeof(m_abISO646)/2;  ++i) {
+    if (m_abISO646[i][0] == bChar) return m_abISO646[i][1];
+  }
+  return 0;
+}
+#endif
+
+#if RELEASE_EVENTS
+//++
+//   Return true if SendChar() will actually send something for this character.
+// That's everything except zero and, with CHARSET_ISO646, the Latin-1
+// characters that have no ISO 646 code in this layout ...
+//--
+PRIVATE bool CanSendChar (uint8_t bChar)
+{
+  if (bChar == 0) return false;
+#if CHARSET == CHARSET_ISO646
+  if ((bChar > 0x80) && (ToISO646(bChar) == 0)) return false;
+#endif
+  return true;
+}
+#endif
+
+//++
+//   Send one character from the layout table to the host.  Seven bit ASCII
+// is sent as is, 0x80 is a NUL (e.g. CONTROL-SHIFT-@) and the Latin-1
+// characters, 0xA0..0xFF, are sent according to the CHARSET option.  Note
+// that they're never sent as a single byte, because that would collide with
+// the special key codes...
+//--
+PRIVATE void SendChar (uint8_t bChar)
+{
+  if (bChar < 0x80) {
+    SendHost(bChar);  return;
+  }
+  if (bChar == 0x80) {
+    SendHost(0);  return;
+  }
+#if CHARSET == CHARSET_ISO646
+  bChar = ToISO646(bChar);
+  if (bChar != 0) SendHost(bChar);
+#elif CHARSET == CHARSET_PREFIX
+  SendHost(KEY_LATIN1);  SendHost(bChar & 0x7F);
+#else
+  SendHost(0xC0 | (bChar >> 6));  SendHost(0x80 | (bChar & 0x3F));
+#endif
+}
+
 PRIVATE bool DoASCII (uint8_t bKey, bool fRelease)
 {
-  uint8_t bASCII, bShift;
-  bShift = (m_fLeftShiftDown | m_fRightShiftDown) ? 1 : 0;
-  if (m_fControlDown) bShift |= 2;
-  bASCII = g_abScanCodes[bKey][bShift];
+  uint8_t bASCII = LookupASCII(bKey, m_bShiftPlane);
   if (bASCII == 0) return false;
-  if (fRelease) return true;
-  bASCII &= 0x7F;
+  if (fRelease) {
+#if RELEASE_EVENTS
+    //   The release sends the unshifted character, but only if there is one
+    // that SendChar() can send - a bare KEY_RELEASE would make the host think
+    // that the next character was released instead ...
+    bASCII = LookupASCII(bKey, 0);
+    if (CanSendChar(bASCII)) {
+      SendHost(KEY_RELEASE);  SendChar(bASCII);
+    }
+#endif
+    return true;
+  }
   if (m_fCapsLockOn && islower(bASCII))
     bASCII = toupper(bASCII);
-  SendHost(bASCII);
+  SendChar(bASCII);
+  return true;
+}
+
+
+#if HOST_REPORT
+//++
+//   Send four hex digits and a space to the host ...
+//--
+PRIVATE void SendHex (uint16_t w)
+{
+  uint8_t i, b;
+  for (i = 0;  i < 4;  ++i) {
+    b = HIBYTE(w) >> 4;  w <<= 4;
+    SendHost((b < 10) ? ('0' + b) : ('A' - 10 + b));
+  }
+  SendHost(' ');
+}
+
+
+//++
+//   Send a status report to the host.  This is KEY_REPORT followed by a line
+// of hex numbers, ending with a carriage return - first the minimum, mean and
+// maximum host latency, and then the latency histogram.  It's triggered by
+// CONTROL+ALT+SCROLL LOCK, and the DEBUG version traces it too ...
+//
+//   With TRACE_RING there's a second line, KEY_REPORT, "T", and then the
+// current time stamp followed by every trace ring entry, oldest first, as
+// four hex digits - the tag byte and then the data byte.
+//
+//   With ERROR_STATS there's a line with KEY_REPORT, "E", and then the parity,
+// framing, timeout and overflow error counts, the number of resyncs, and the
+// number of bytes received from the keyboard and sent to the host.
+//--
+PUBLIC void SendReport (void)
+{
+#if LATENCY_STATS || (TRACE_RING > 0)
+  uint8_t i;
+#endif
+#if TRACE_RING > 0
+  uint8_t n;
+#endif
+#if LATENCY_STATS
+  TRACE2(TR_LAT_MIN, HIBYTE(g_wLatencyMin), LOBYTE(g_wLatencyMin));
+  TRACE2(TR_LAT_MEAN, HIBYTE(g_wLatencyMean), LOBYTE(g_wLatencyMean));
+  TRACE2(TR_LAT_MAX, HIBYTE(g_wLatencyMax), LOBYTE(g_wLatencyMax));
+#ifdef DEBUG
+  for (i = 0;  i < LATENCY_BUCKETS;  ++i)
+    TRACE2(TR_LAT_BUCKET, i, g_abLatencyHistogram[i]);
+#endif
+  SendHost(KEY_REPORT);
+  SendHex(g_wLatencyMin);  SendHex(g_wLatencyMean);  SendHex(g_wLatencyMax);
+  for (i = 0;  i < LATENCY_BUCKETS;  ++i)  SendHex(g_abLatencyHistogram[i]);
+  SendHost(0x0D);
+#endif
+#if TRACE_RING > 0
+  //   Recording is held off while we send the trace, or the report itself
+  // would overwrite the entries before we got to them ...
+  m_fTraceHold = true;
+  SendHost(KEY_REPORT);  SendHost('T');  SendHost(' ');  SendHex(RING_NOW);
+  i = (m_bTracePut - m_bTraceCount) & (TRACE_RING-1);
+  for (n = m_bTraceCount;  n != 0;  --n) {
+    SendHex(MKWORD(m_abTraceRing[i][0], m_abTraceRing[i][1]));
+    i = (i+1) & (TRACE_RING-1);
+  }
+  SendHost(0x0D);
+  m_fTraceHold = false;
+#endif
+#if ERROR_STATS
+  SendHost(KEY_REPORT);  SendHost('E');  SendHost(' ');
+  SendHex(g_bParityErrors);  SendHex(g_bFramingErrors);
+  SendHex(g_bTimeoutErrors);  SendHex(g_bOverflows);  SendHex(g_bResyncs);
+  SendHex(g_wBytesReceived);  SendHex(g_wBytesSent);
+  SendHost(0x0D);
+#endif
+}
+#endif
+
+
+//++
+//   When pressed, the PAUSE/BREAK key sends the absolutely bizzare sequence
+// E1 14 77 E1 F0 14 F0 77.  This is called after the E1 has been read to read
+// and throw away the rest, so that they don't get misinterpreted as something
+// else.  It returns TRUE if the whole sequence was there, and FALSE if it
+// wasn't.  BTW, what does PAUSE/BREAK send when it's released ??  Answer:
+// Absolutely nothing!
+//--
+PRIVATE bool DoPause (void)
+{
+  if (WaitKey() != 0x14) return false;
+  if (WaitKey() != 0x77) return false;
+  if (WaitKey() != 0xE1) return false;
+  if (WaitKey() != 0xF0) return false;
+  if (WaitKey() != 0x14) return false;
+  if (WaitKey() != 0xF0) return false;
+  if (WaitKey() != 0x77) return false;
+  TRACE0(TR_PAUSE);
   return true;
 }
 
@@ -452,53 +1459,53 @@ PRIVATE bool DoASCII (uint8_t bKey, bool fRelease)
 //   This routine is the keyboard "task" - it's an endless loop that runs
 // forever reading bytes from the keyboard, converting them to ASCII, and
 // sending them to the host.  It never returns ...
+//
+//   Note that any key handled here before DoASCII() gets a chance at it can
+// never be typed from the scancode table.  mklayout checks the layouts for
+// that, so if you change the list here then update g_abUnreachable[] there!
 //--
 PUBLIC void ConvertKeys (void)
 {
   uint8_t bKey;  bool fRelease;
-  m_bShiftFlags = 0;
+  m_bShiftFlags = 0;  m_bShiftPlane = 0;
+  m_fSwapCapsControl = SWAP_CAPSLOCK_AND_CONTROL;
+#if LAYOUT_COUNT > 1
+  SelectLayout(ALTERNATE_LAYOUT ? 1 : 0);
+#endif
+  SelectKeyMode(KEY_MODE);
   while (true) {
-    bKey = WaitKey();  fRelease = false;
+    m_fBetweenKeys = true;  bKey = WaitKey();  m_fBetweenKeys = false;
+    fRelease = false;
 
     if (DoSpecial(bKey)) continue;
     if (bKey == 0xE0) {
       DoExtended();  continue;
     }
     if (bKey == 0xE1) {
-      //   When pressed, the PAUSE/BREAK key sends the absolutely bizzare
-      // sequence E1 14 77 E1 F0 14 F0 77.  We don't do anything with this
-      // key, but we need to read and throw away these bytes so that they
-      // don't get misinterpreted as something else.  BTW, what does PAUSE/
-      // BREAK send when it's released ??  Answer: Absolutely nothing!
-      if (WaitKey() != 0x14) continue;
-      if (WaitKey() != 0x77) continue;
-      if (WaitKey() != 0xE1) continue;
-      if (WaitKey() != 0xF0) continue;
-      if (WaitKey() != 0x14) continue;
-      if (WaitKey() != 0xF0) continue;
-      if (WaitKey() != 0x77) continue;
-      DBGOUT(("KBD: PAUSE/BREAK pressed\n"));
+      if (!DoPause()) continue;
       //   This key sends 0x80 to the host, which (if you strip the 8th bit)
       // would be a NULL and ignored.  The VT1802/VIS1802 can check for this
       // if it wants to though, and trigger a break condition on the UART.
-      SendHost(KEY_BREAK);
+      SendKey(KEY_BREAK);
       continue;
     }
     if (bKey == 0xF0) {
       fRelease = true;  bKey = WaitKey();
     }
+    if (IsRepeat(bKey, fRelease)) continue;
     if (bKey == 0x77) {
-      if (!fRelease){
-	DBGOUT(("KBD: NUM LOCK pressed\n"));
-	SendHost(KEY_NUMLOCK);
-      }
+      if (!fRelease) TRACE0(TR_NUMLOCK);
+      SendKeyEvent(KEY_NUMLOCK, fRelease);
       continue;
     }
     if (bKey == 0x7E) {
-      if (!fRelease) {
-	DBGOUT(("KBD: SCROLL LOCK pressed\n"));
-	SendHost(KEY_SCRLCK);
-      }
+      if (!fRelease) TRACE0(TR_SCRLCK);
+#if HOST_REPORT
+      if (!fRelease && m_fControlDown && m_fAltDown)
+	SendReport();
+      else
+#endif
+	SendKeyEvent(KEY_SCRLCK, fRelease);
       continue;
     }
     if (DoShift(bKey, fRelease, false)) continue;
@@ -506,7 +1513,103 @@ PUBLIC void ConvertKeys (void)
     if (DoKeypad(bKey, fRelease)) continue;
     if (DoASCII(bKey, fRelease)) continue;
 
-    DBGOUT(("KBD: unknown scan code 0x%x\n", bKey));
+    TRACE1(TR_UNKNOWN, bKey);
   }
 }
 
+
+#if PASSTHROUGH == PASSTHROUGH_EVENTS
+//++
+//   In the compact event mode every key is sent as a single byte - bit 7 is
+// set if the key was released, and the lower seven bits are a key ID.  For
+// most keys the key ID is just the set 2 scan code, and keys with extended
+// (E0) codes are folded into codes that aren't used by the base keyboard.
+// This table maps those extended codes to their key IDs.  F7 (0x83) is the
+// only base key with a code above 0x7F, and it gets ID 0x02.  PAUSE/BREAK,
+// which has no release code, sends only ID 0x37.  Every byte from 0x80 up is
+// a release here, so nothing else (not even KEY_VERSION, see main()) is ever
+// sent to the host in this mode...
+//--
+#define EVENT_F7	0x02	// key ID for F7
+#define EVENT_PAUSE	0x37	// key ID for PAUSE/BREAK
+PRIVATE uint8_t const __code m_abExtendedIDs[][2] = {
+  {0x11, 0x0F},		// right ALT
+  {0x14, 0x10},		// right CONTROL
+  {0x1F, 0x1F},		// left WINDOWS
+  {0x27, 0x27},		// right WINDOWS
+  {0x2F, 0x2F},		// MENU
+  {0x4A, 0x60},		// KEYPAD /
+  {0x5A, 0x62},		// KEYPAD ENTER
+  {0x69, 0x65},		// END
+  {0x6B, 0x68},		// LEFT ARROW
+  {0x6C, 0x6D},		// HOME
+  {0x70, 0x6E},		// INSERT
+  {0x71, 0x6F},		// DELETE
+  {0x72, 0x17},		// DOWN ARROW
+  {0x74, 0x18},		// RIGHT ARROW
+  {0x75, 0x19},		// UP ARROW
+  {0x7A, 0x20},		// PAGE DOWN
+  {0x7C, 0x30},		// PRINT SCREEN
+  {0x7D, 0x28},		// PAGE UP
+};
+#define EXTENDED_IDS	(sizeof(m_abExtendedIDs) / sizeof(m_abExtendedIDs[0]))
+
+//++
+//   Return the key ID for an extended key code, or zero if it isn't one we
+// know about.  That includes the "fake shift" E0 12 codes that PRINT SCREEN
+// and some other keys send, which are simply ignored.
+//--
+PRIVATE uint8_t FoldExtended (uint8_t bKey)
+{
+  uint8_t i;
+  for (i = 0;  i < EXTENDED_IDS;  ++i)
+    if (m_abExtendedIDs[i][0] == bKey) return m_abExtendedIDs[i][1];
+  return 0;
+}
+#endif
+
+
+#if PASSTHROUGH != 0
+//++
+//   This routine replaces ConvertKeys() when the PASSTHROUGH option is used,
+// for hosts that have their own keymaps and just want the keys as fast as
+// possible.  It's another endless loop, and it uses the same SendHost()
+// handshake, but none of the translation is done here.  Keyboard errors are
+// still handled by WaitKey(), and in event mode the keyboard's own messages
+// (ACK, BAT, etc) are dropped.
+//--
+PUBLIC void PassthroughKeys (void)
+{
+  uint8_t bKey;
+#if PASSTHROUGH == PASSTHROUGH_EVENTS
+  bool fExtended, fRelease;
+#endif
+  while (true) {
+    m_fBetweenKeys = true;  bKey = WaitKey();  m_fBetweenKeys = false;
+#if PASSTHROUGH == PASSTHROUGH_RAW
+    SendHost(bKey);
+#else
+    if (DoSpecial(bKey)) continue;
+    if (bKey == 0xE1) {
+      if (DoPause()) SendHost(EVENT_PAUSE);
+      continue;
+    }
+    fExtended = fRelease = false;
+    if (bKey == 0xE0) {
+      fExtended = true;  bKey = WaitKey();
+    }
+    if (bKey == 0xF0) {
+      fRelease = true;  bKey = WaitKey();
+    }
+    if (fExtended)
+      bKey = FoldExtended(bKey);
+    else if (bKey == 0x83)
+      bKey = EVENT_F7;
+    if ((bKey == 0) || (bKey > 0x7F)) {
+      TRACE1(TR_UNKNOWN, bKey);  continue;
+    }
+    SendHost(fRelease ? (bKey | 0x80) : bKey);
+#endif
+  }
+}
+#endif
@@ -21,10 +21,208 @@
 //REVISION HISTORY:
 // dd-mmm-yy    who     description
 //  5-Feb-06	RLA	New file.
+// 16-Oct-26	RLA	Add the PASSTHROUGH option.
+// 16-Oct-26	RLA	Add HOSTBUFLEN.
+// 16-Oct-26	RLA	Add HOST_TIMEOUT and HOST_POLICY.
+// 16-Oct-26	RLA	Add REPEAT_BACKLOG.
+// 16-Oct-26	RLA	Add HOST_SERIAL for HOST_UART.
+// 16-Oct-26	RLA	Add LATENCY_STATS.
+// 16-Oct-26	RLA	Add RELEASE_EVENTS.
+// 16-Oct-26	RLA	Add CHARSET.
+// 16-Oct-26	RLA	Add TRACE_RING.
+// 16-Oct-26	RLA	Add ERROR_STATS.
+// 16-Oct-26	RLA	Add IDLE_MODE.
+// 16-Oct-26	RLA	Add POWER_DOWN.
+// 16-Oct-26	RLA	Add TYPEMATIC_DELAY and TYPEMATIC_RATE.
+// 16-Oct-26	RLA	Add KEY_BITMAP.
+// 16-Oct-26	RLA	Default IDLE_MODE and HOST_TIMEOUT as the Makefile does.
+// 16-Oct-26	RLA	Explain the TYPEMATIC_DELAY and TYPEMATIC_RATE limits.
 //--
 #pragma once
 
+//   PASSTHROUGH selects what gets sent to the host (this is normally set by
+// the Makefile) -
+//
+//	0 - translate keys to ASCII and special key codes (ConvertKeys)
+//	1 - send the raw PS/2 scan code bytes, exactly as received
+//	2 - send one compact event byte per key - bit 7 is set for a release
+//	    and bits 6..0 are the key ID (see PassthroughKeys() in host.c).
+//	    Nothing else, not even the version number, is sent in this mode.
+#ifndef PASSTHROUGH
+#define PASSTHROUGH	0
+#endif
+#define PASSTHROUGH_RAW		1
+#define PASSTHROUGH_EVENTS	2
+
+// Size of the host output FIFO - this MUST BE A POWER OF TWO!
+#ifndef HOSTBUFLEN
+#define HOSTBUFLEN	16
+#endif
+#if (HOSTBUFLEN & (HOSTBUFLEN-1)) != 0
+#error HOSTBUFLEN must be a power of two
+#endif
+
+//   If the host doesn't read a byte within HOST_TIMEOUT milliseconds (zero
+// means wait forever) and the FIFO is full, then HOST_POLICY says what to do -
+//
+//	HOST_DROP_OLDEST - throw away the oldest byte in the FIFO
+//	HOST_DROP_NEWEST - throw away the new byte
+//	HOST_HOLD	 - inhibit the keyboard until the host reads the byte
+#define HOST_DROP_OLDEST	0
+#define HOST_DROP_NEWEST	1
+#define HOST_HOLD		2
+#ifndef HOST_TIMEOUT
+#define HOST_TIMEOUT		250
+#endif
+#ifndef HOST_POLICY
+#define HOST_POLICY		HOST_HOLD
+#endif
+//   LATENCY_STATS keeps statistics on how long the host takes to read each
+// byte (see host.c).  It's off by default because it costs 16 bytes of RAM.
+#ifndef LATENCY_STATS
+#define LATENCY_STATS		0
+#endif
+
+//   IDLE_MODE puts the CPU in idle mode whenever there's nothing to do, rather
+// than spinning on GetKey(), until the next keyboard clock, timer tick or
+// UART interrupt (see WaitKey() in host.c) ...
+#ifndef IDLE_MODE
+#define IDLE_MODE		1
+#endif
+
+//   POWER_DOWN stops the oscillator after that many milliseconds with no
+// keyboard activity (zero means never) and the keyboard wakes us up again
+// (see Sleep() in host.c).  It needs a CPU that can wake up from power down on
+// INT0 - the AT89C2051 can't!  It should be longer than the longest typematic
+// delay (one second), and the tick count limits it to about 50 seconds ...
+#ifndef POWER_DOWN
+#define POWER_DOWN		0
+#endif
+#if (POWER_DOWN > 0) && ((POWER_DOWN < 1000) || (POWER_DOWN > 50000))
+#error POWER_DOWN must be zero or 1000..50000 milliseconds
+#endif
+#if (POWER_DOWN > 0) && defined(DEBUG)
+#error POWER_DOWN can not be used with DEBUG
+#endif
+
+//   ERROR_STATS counts keyboard errors of each kind, keyboard resyncs, and the
+// bytes received from the keyboard and sent to the host (see host.c).  It's
+// off by default because it costs 9 bytes of RAM.
+#ifndef ERROR_STATS
+#define ERROR_STATS		0
+#endif
+
+//   Pulse mode and UART hosts (see ps2apu.h) never make us wait and never
+// acknowledge anything, so there's no timeout and nothing to measure ...
+#if (STROBE_PULSE > 0) || HOST_UART
+#undef HOST_TIMEOUT
+#define HOST_TIMEOUT		0
+#undef LATENCY_STATS
+#define LATENCY_STATS		0
+#endif
+
+//   RELEASE_EVENTS sends KEY_RELEASE and the key's code to the host when a
+// key is released, as well as the usual code when it's pressed ...
+#ifndef RELEASE_EVENTS
+#define RELEASE_EVENTS		0
+#endif
+
+//   The layout tables hold ISO 8859-1 (Latin-1) characters, and CHARSET says
+// how the ones above 0x7F are sent to the host -
+//
+//	0 - ISO 646 - send the seven bit national replacement (e.g. a umlaut
+//	    is "{") or nothing at all if there isn't one.  This is what the
+//	    APU always did before, and it's the default.
+//	1 - send KEY_LATIN1 followed by the character less 0x80, which can
+//	    never be confused with a special key code
+//	2 - send the character as UTF-8 (two bytes, 0xC2 or 0xC3 and then
+//	    0x80..0xBF)
+#define CHARSET_ISO646		0
+#define CHARSET_PREFIX		1
+#define CHARSET_UTF8		2
+#ifndef CHARSET
+#define CHARSET			CHARSET_ISO646
+#endif
+
+//   TRACE_RING keeps the last TRACE_RING keyboard bytes, keyboard errors and
+// host bytes in RAM, so there's something to look at when a unit misbehaves
+// (see host.c).  It MUST BE A POWER OF TWO, and each entry costs two bytes of
+// RAM.  Zero turns it off ...
+#ifndef TRACE_RING
+#define TRACE_RING		0
+#endif
+#if (TRACE_RING & (TRACE_RING-1)) != 0
+#error TRACE_RING must be a power of two
+#endif
+//   Each trace ring entry is a tag byte and a data byte.  The upper two bits
+// of the tag are the entry type and the lower six bits are the time, in units
+// of four timer ticks (about 3.4ms at 14.318MHz) ...
+#define RING_KEY		0x00	// byte received from the keyboard
+#define RING_ERROR		0x40	// keyboard error (g_bKeyFlags)
+#define RING_HOST		0x80	// byte sent to the host
+#define RING_DROP		0xC0	// byte dropped after a host timeout
+#define RING_TYPE		0xC0	// mask for the entry type
+#define RING_TIME		0x3F	//  "    "   "  time stamp
+
+// Number of latency histogram buckets ...
+#define LATENCY_BUCKETS		8
+
+//   When the keyboard repeats a held key, the repeats are thrown away if there
+// are REPEAT_BACKLOG or more bytes still waiting for the host (zero means
+// never throw them away) ...
+#ifndef REPEAT_BACKLOG
+#define REPEAT_BACKLOG		4
+#endif
+
+//   If TYPEMATIC_DELAY isn't zero, then the keyboard's own repeats are thrown
+// away and we make our own instead - the first one TYPEMATIC_DELAY milliseconds
+// after the key is pressed, and then one every TYPEMATIC_RATE milliseconds
+// after that, but only when the host has caught up (see NextRepeat() in
+// host.c).  This only applies to translated keys - PASSTHROUGH sends whatever
+// the keyboard sends.  The 16 bit tick count limits both to about 50 seconds,
+// just like POWER_DOWN ...
+#ifndef TYPEMATIC_DELAY
+#define TYPEMATIC_DELAY		0
+#endif
+#ifndef TYPEMATIC_RATE
+#define TYPEMATIC_RATE		100
+#endif
+//   KEY_BITMAP keeps track of every key that's down, not just the last one
+// (see IsRepeat() in host.c).  It's off by default because it costs 32 bytes
+// of RAM ...
+#ifndef KEY_BITMAP
+#define KEY_BITMAP		0
+#endif
+#if (TYPEMATIC_DELAY > 50000) || (TYPEMATIC_RATE < 1) \
+ || (TYPEMATIC_RATE > 50000)
+#error TYPEMATIC_DELAY and TYPEMATIC_RATE must be 1..50000 milliseconds
+#endif
 
 // Function prototypes...
 extern void SendHost (uint8_t ch);
 extern void ConvertKeys (void);
+extern void PassthroughKeys (void);
+#if HOST_UART
+extern void HOST_SERIAL (void) __interrupt (4);
+#endif
+
+//   CONTROL+ALT+SCROLL LOCK sends a report to the host if there's anything to
+// report ...
+#define HOST_REPORT	(LATENCY_STATS || (TRACE_RING > 0) || ERROR_STATS)
+#if HOST_REPORT
+extern void SendReport (void);
+#endif
+
+// Global data definitions...
+#if HOST_TIMEOUT > 0
+extern uint16_t __data g_wHostTimeouts;
+#endif
+#if ERROR_STATS
+extern uint8_t __data g_bParityErrors, g_bFramingErrors, g_bTimeoutErrors;
+extern uint8_t __data g_bOverflows, g_bResyncs;
+extern uint16_t __data g_wBytesReceived, g_wBytesSent;
+#endif
+#if LATENCY_STATS
+extern uint16_t __data g_wLatencyMin, g_wLatencyMax, g_wLatencyMean;
+extern uint8_t __data g_abLatencyHistogram[LATENCY_BUCKETS];
+#endif
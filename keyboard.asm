@@ -58,22 +58,49 @@
 ; keyboard, there's no mechanism to ever get them back into sync again.  It'll
 ; never work again!
 ;
-;   The solution is to use timer 0 to implement a time out function.  Timer 0
-; is programmed for a delay of approximately 2ms (about twice as long as the
-; longest keyboard transmission should ever take), and the timer is started
-; when we receive the start bit from the keyboard and stopped when we receive
-; the stop bit.  If all is well timer 0 will never overflow, but if something
-; goes wrong then the timer 0 interrupt routine will post a timeout error and
-; reset the keyboard state machine back to the idle state.
+;   The solution is a time out.  Timer 0 runs all the time as a system "tick"
+; (about 1ms, see below), and the START state loads m_bKeyTimer with a count
+; of ticks (about twice as long as the longest keyboard transmission should
+; ever take).  The tick interrupt counts it down as long as the receiver is
+; busy, and the stop bit clears the busy flag.  If all is well m_bKeyTimer
+; never reaches zero, but if something goes wrong then the tick interrupt
+; will post a timeout error and reset the keyboard state machine back to the
+; idle state.
+;
+;   The tick itself is timer 0 in mode 1 (16 bit).  The interrupt reloads only
+; TH0, and never touches TL0, so the timer keeps counting during interrupt
+; latency and the tick never drifts.  A tick is 1024 machine cycles, or about
+; 0.86ms at 14.318MHz.  The C code reads the tick count with GetTicks() and
+; keyboard.h defines TICKS_PER_SECOND.
+;
+;   The keyboard can also be inhibited, which the PS/2 standard says is done
+; by holding the clock low.  The keyboard will buffer keys internally (and
+; retransmit anything that gets interrupted) until we let the clock go.
+;
+;   PowerDown stops the oscillator until the keyboard starts sending again.
+; The receiver can't catch that byte - by the time the oscillator is running
+; again we've missed the start bit and probably more - so the first clock edge
+; instead puts the ISR into the WAKE state, which inhibits the keyboard right
+; away.  If we get there before the keyboard's tenth clock, then the keyboard
+; will abort the byte and send it again after the clock is released.
 ;
 ;REVISION HISTORY:
 ; dd-mmm-yy	who     description
 ;  5-Feb-06	RLA	New file.
 ; 28-Apr-19	TAF	Ported to sdas8051 distributed with sdcc
+; 16-Oct-26	RLA	Make timer 0 a free running system tick and do the
+;			  keyboard timeout in software.
+;			Add InhibitKeyboard and ReleaseKeyboard.
+;			Add GetCycles.
+; 16-Oct-26	RLA	Add PowerDown and the WAKE state.
+; 16-Oct-26	RLA	Add InjectKey.
+; 16-Oct-26	RLA	TIMER_TICK saves the PSW and restores EX0.
 ;--
 
 	.globl	_InitializeKeyboard, _GetKey, _g_bKeyFlags
-	.globl	_KEYBOARD_BIT, _KEYBOARD_TIMEOUT
+	.globl	_InhibitKeyboard, _ReleaseKeyboard, _PowerDown, _InjectKey
+	.globl	_InitializeTimer, _GetTicks, _GetCycles, _g_wTicks
+	.globl	_KEYBOARD_BIT, _TIMER_TICK
 
 
 ;   These are the physical I/O bits that are connected to the PS/2 keyboard.
@@ -86,10 +113,13 @@ KEYBOARD_DATA	.equ	P3.7		; keyboard data
 ; with the same constant in keyboard.h...
 KEYBUFLEN	.equ	16		; MUST BE A POWER OF TWO!!
 
-; This constant is an approximately 2ms time out for timer 0.
-TIMEOUT_COUNT	.equ	-1842		; 2ms with a clock of 11.0592MHz 
+; Timer 0 system tick - reload TH0 only, for 1024 machine cycles per tick...
+TICK_RELOAD	.equ	0xFC		; TH0 reload value (must agree with keyboard.h)
+KEY_TIMEOUT	.equ	3		; keyboard timeout (2..3 ticks, about 2ms)
 T1_MASK		.equ	0xF0		; TMOD mask to clear T0 bits
 T0_M0		.equ	0x01		; mode bits for timer 0
+PCON_PD		.equ	0x02		; PCON power down bit
+WAKE_STATE	.equ	12		; KEYBOARD_BIT state after a power down
 
 ;--------------------------------------------------------
 ; overlayable register banks
@@ -118,6 +148,8 @@ m_bKeyData:	.ds	1      		; last data byte read from the keyboard
 m_bKeyGet:	.ds	1      		; "get" pointer to circular buffer
 m_bKeyPut:	.ds	1   		; "put"  "   "   "   "   "     "
 m_abKeyBuffer:	.ds	KEYBUFLEN	; circular buffer for bytes received
+m_bKeyTimer:	.ds	1		; ticks left before a keyboard timeout
+_g_wTicks:	.ds	2		; free running 16 bit tick count
 
         AR7 = 0x07
         AR6 = 0x06
@@ -142,30 +174,137 @@ m_abKeyBuffer:	.ds	KEYBUFLEN	; circular buffer for bytes received
 ; DESCRIPTION:
 ;   This routine will intialize the keyboard interface.  Remember that the
 ; KEYBOARD_CLOCK is connected to the INT0 input, and this pin is initialized
-; to interrupt on every negative edge.
+; to interrupt on every negative edge.  The keyboard has the high priority
+; interrupt, so the timer tick never delays a keyboard bit.  This is also
+; called to recover from keyboard errors, so it doesn't touch timer 0!
 ;--
 _InitializeKeyboard:
 ; Initialize any internal data and variables...
+	CLR	EX0		; no keyboard interrupts for now
 	MOV	A, #0	       	; clear the circular buffer
 	MOV	m_bKeyGet, A   	; ...
 	MOV	m_bKeyPut, A	; ...
 	MOV	m_bKeyState, A	; reset the state to idle
 	MOV	_g_bKeyFlags, A	; and clear all the errors/flags
 
-; Initialize timer 0 as a timeout counter...
-	ANL	TMOD, #T1_MASK	; clear the timer 0 mode bits
-	ORL	TMOD, #T0_M0	; select mode 1 (sixteen bit auto reload) timer
-	CLR	TR0		; make sure the timer's not running for now
-	SETB	ET0		; enable timer 0 interrupts
-	
 ; Setup the external hardware for INT0...
 	SETB	KEYBOARD_CLOCK	; be sure both keyboard and data
 	SETB	KEYBOARD_DATA   ;  ... signals are free
 	SETB	IT0		; make INT0 edge triggered
+	SETB	PX0		; and give it the high priority
+	CLR	IE0		; forget about any old edges
 	SETB	EX0		; enable INT0 interrupts and we're done
 	RET		       	; ...
 
 
+;++
+; InhibitKeyboard
+;
+; DESCRIPTION:
+;   This routine will inhibit the keyboard by pulling the clock line low.  The
+; keyboard will buffer any keys typed until the clock is released, and if we
+; interrupt a byte in progress then the keyboard will send it again later.
+; The receiver is reset to idle and INT0 is disabled, since pulling the clock
+; low would otherwise look like a start bit.  Note that GetKey re-enables
+; INT0, so don't call it while the keyboard is inhibited!
+;--
+_InhibitKeyboard:
+	CLR	EX0		; no more keyboard interrupts
+	CLR	KEYBOARD_CLOCK	; hold the clock low
+	CLR	m_fKeyBusy	; and reset the receiver to idle
+	MOV	m_bKeyState, #0	; ...
+	RET			; ...
+
+
+;++
+; ReleaseKeyboard
+;
+; DESCRIPTION:
+;   This routine undoes InhibitKeyboard - it releases the clock line and
+; re-enables INT0.  The falling edge from InhibitKeyboard left IE0 set, so
+; that has to be cleared first.
+;--
+_ReleaseKeyboard:
+	SETB	KEYBOARD_CLOCK	; let the keyboard have the clock back
+	CLR	IE0		; forget the edge we made
+	SETB	EX0		; and enable keyboard interrupts again
+	RET			; ...
+
+
+;++
+; PowerDown
+;
+; DESCRIPTION:
+;   This routine stops the oscillator (PCON.PD) until the keyboard sends
+; something.  It returns 1 in DPL after it wakes up, and the keyboard will be
+; inhibited then (see the WAKE state) - the caller has to wait a bit and then
+; call InitializeKeyboard.  If the receiver is busy, or INT0 has already seen
+; a start bit, then it doesn't power down and returns 0 instead.
+;
+;   Only a level triggered INT0 can wake up from power down, and remember that
+; the original AT89C2051 can only get out of power down with a reset - this
+; needs one of the parts that can wake up on INT0 (e.g. the AT89LP2052).  The
+; 8051 always executes one more instruction after a write to IE, so an edge
+; that sneaks in after the checks still can't be serviced before we're in
+; power down, and it just wakes us up again right away.
+;--
+_PowerDown:
+	CLR	EX0		; no keyboard interrupts for a moment
+	JB	m_fKeyBusy,PWRD1; don't power down in the middle of a byte
+	JB	IE0, PWRD1	; or if one is just starting
+	MOV	m_bKeyState, #WAKE_STATE; the next clock edge wakes us up
+	CLR	IT0		; only a low level can wake up the CPU
+	SETB	EX0		; enable INT0 interrupts
+	ORL	PCON, #PCON_PD	; and stop the oscillator
+	NOP			; ...
+	MOV	DPL, #1		; we powered down and woke up again
+	RET			; ...
+
+; Here if the keyboard is busy and we can't power down...
+PWRD1:	SETB	EX0		; re-enable keyboard interrupts
+	MOV	DPL, #0		; and return 0
+	RET			; ...
+
+
+;++
+; InitializeTimer
+;
+; DESCRIPTION:
+;   This routine will initialize timer 0 as the free running system tick
+; and enable its interrupt.  It's called once at startup, before the keyboard
+; is initialized.
+;--
+_InitializeTimer:
+	CLR	TR0		; stop the timer while we change it
+	ANL	TMOD, #T1_MASK	; clear the timer 0 mode bits
+	ORL	TMOD, #T0_M0	; select mode 1 (sixteen bit) timer
+	MOV	TH0, #TICK_RELOAD; load the first tick
+	MOV	TL0, #0		; ...
+	MOV	_g_wTicks, #0	; and reset the tick count
+	MOV	_g_wTicks+1, #0	; ...
+	MOV	m_bKeyTimer, #0	; ...
+	CLR	TF0		; make sure the timer flag is cleared
+	SETB	ET0		; enable timer 0 interrupts
+	SETB	TR0		; and start it running
+	RET			; ...
+
+
+;++
+; GetTicks
+;
+; DESCRIPTION:
+;   This routine returns the current 16 bit tick count in DPH:DPL.  The
+; timer interrupt is disabled while we read it so that we can't get half of
+; an old count and half of a new one...
+;--
+_GetTicks:
+	CLR	ET0		; no tick interrupts for a moment
+	MOV	DPL, _g_wTicks	; get the low byte
+	MOV	DPH, _g_wTicks+1; and the high byte
+	SETB	ET0		; interrupts are OK again
+	RET			; ...
+
+
 ;++
 ; GetKey
 ;
@@ -226,6 +365,31 @@ NOROOM:	SETB	m_fKeyOverflow	; set the overflow error bit
 	RET			; and just discard the data byte
 
 
+;++
+; InjectKey
+;
+; DESCRIPTION:
+;   This routine adds the byte in DPL to the keyboard buffer, just as if the
+; keyboard had sent it.  It's used by the DEBUG version's monitor for load
+; testing.  INT0 is disabled while we're here, because the KEYBOARD_BIT ISR
+; uses PutKey too, and m_bKeyData is saved since the ISR might be in the
+; middle of a byte.  The old EX0 is restored afterwards rather than set, so
+; this won't accidentally release an inhibited keyboard.  If the buffer is
+; full then m_fKeyOverflow gets set, just like the real thing.
+;--
+_InjectKey:
+	MOV	C, EX0		; remember whether INT0 was enabled
+	CLR	EX0		; and disable it for now
+	PUSH	PSW		; PutKey changes the carry
+	PUSH	m_bKeyData	; save the partial byte
+	MOV	m_bKeyData, DPL	; PutKey wants the byte here
+	ACALL	PutKey		; add it to the buffer
+	POP	m_bKeyData	; restore the partial byte
+	POP	PSW		; ...
+	MOV	EX0, C		; and INT0
+	RET			; ...
+
+
 ;++
 ; KEYBOARD_BIT
 ;
@@ -255,15 +419,13 @@ KEYTAB:	AJMP	START		; state 0 - start bit
 	AJMP	SPARITY		; state 9 - parity bit
 	AJMP	STOPB		; state 10 - stop bit
 	AJMP	KEYRET		; state 11 - error (just return!)
+	AJMP	WAKE		; state 12 - wake up from power down
 
 ; Here for the start bit...
 START:	JB	KEYBOARD_DATA,FRAERR	; data must be zero for a valid start
 	SETB	m_fKeyBusy		; set tbe busy flag
 	MOV	m_bKeyData, #0		; clear the data accumulator
-	MOV	TH0,#>(TIMEOUT_COUNT)	; initialize the timeout timer
-	MOV	TL0,#<(TIMEOUT_COUNT)	; ...
-	CLR	TF0			; make sure the timer flag is cleared
-	SETB	TR0			; and start it running
+	MOV	m_bKeyTimer, #KEY_TIMEOUT; start the timeout
 	AJMP	KEYNXT			; move to the next state and return
 
 ; Here for a framing error (bad start or stop bit)...
@@ -291,8 +453,7 @@ BADPAR:	SETB	m_fKeyParity		; set the parity error flag
 	AJMP	KEYRET			; ...
 
 ; And here for the stop bit...
-STOPB:	CLR	m_fKeyBusy		; clear the busy flag
-	CLR	TR0			; and stop the timeout timer
+STOPB:	CLR	m_fKeyBusy		; clear the busy flag (stops the timeout)
 	JNB	KEYBOARD_DATA, FRAERR	; the stop bit must be a one
 	ACALL	PutKey			; store the key in the buffer
 
@@ -300,6 +461,13 @@ STOPB:	CLR	m_fKeyBusy		; clear the busy flag
 	MOV	m_bKeyState, #0		; back to state zero for the next byte
 	AJMP	KEYRET			; and return
 
+; Here for the first clock edge after a power down...
+WAKE:	CLR	KEYBOARD_CLOCK		; inhibit the keyboard NOW
+	SETB	IT0			; INT0 is edge triggered again
+	CLR	EX0			; and stays off until we release it
+	MOV	m_bKeyState, #0		; the receiver is idle again
+	AJMP	KEYRET			; and return
+
 ; Here to return from the interrupt...
 KEYNXT:	INC	m_bKeyState		; on to the next state	
 KEYRET:	POP	DPL			; restore the original context
@@ -311,17 +479,74 @@ KEYRET:	POP	DPL			; restore the original context
 
 
 ;++
-; KEYBOARD_TIMEOUT
+; GetCycles
 ;
 ; DESCRIPTION:
-;   We get here if the timeout timer goes off before we find the stop bit in a
-; byte from the keyboard.  Something bad must have happened - set the timeout
-; error flag, clear the keyboard busy flag, and reset the keyboard back to 
-; state 0 (idle)...
+;   This routine returns a 16 bit time stamp in machine cycles - the low six
+; bits of the tick count and the ten bits of timer 0 that make up a tick.  It
+; wraps around every 64 ticks (about 55ms), so it's only good for timing short
+; things.  The tick interrupt is held off while we read it, and if timer 0 has
+; overflowed but the tick hasn't been counted yet, then we count it here.  We
+; can tell whether that happened before or after we read TH0 because TH0 is
+; 0xFC..0xFF before the overflow and 0x00..0x03 after (until the interrupt
+; reloads it)...
 ;--
-_KEYBOARD_TIMEOUT:
-	SETB	m_fKeyTimeout		; set the timeout flag
+_GetCycles:
+	CLR	ET0		; hold off the tick interrupt
+	MOV	A, TH0		; get the high byte of the timer
+	MOV	DPL, TL0	; and the low byte
+	CJNE	A, TH0, GETC1	; did TL0 overflow in between?
+	SJMP	GETC2		; no - we're good
+GETC1:	MOV	A, TH0		; yes - just read both again
+	MOV	DPL, TL0	; (it can't happen twice in a row!)
+GETC2:	MOV	B, A		; save TH0 for a moment
+	MOV	A, _g_wTicks	; get the low byte of the tick count
+	JNB	TF0, GETC3	; is there a tick waiting to be counted?
+	JB	B.7, GETC3	; and did we read TH0 after that happened?
+	INC	A		; yes - count it now
+GETC3:	SETB	ET0		; the tick can go on now
+	RL	A		; put the tick count in bits 7..2
+	RL	A		; ...
+	ANL	A, #0xFC	; ...
+	XCH	A, B		; and get TH0 back
+	ANL	A, #0x03	; only the low two bits count
+	ORL	A, B		; combine them with the ticks
+	MOV	DPH, A		; and return the result in DPH:DPL
+	RET			; ...
+
+
+;++
+; TIMER_TICK
+;
+; DESCRIPTION:
+;   This is the timer 0 interrupt - the system tick.  It reloads TH0 for the
+; next tick and increments the tick count.  Then, if the keyboard receiver is
+; busy, it counts down the keyboard timeout.  If that goes off before we find
+; the stop bit in a byte from the keyboard then something bad must have
+; happened - set the timeout error flag, clear the keyboard busy flag, and
+; reset the keyboard back to state 0 (idle).  That's done with the keyboard
+; interrupt disabled, so a keyboard bit can't sneak in while we do it...
+;
+;   Note that the tick can go off while GetKey or InjectKey has the keyboard
+; interrupt disabled, so EX0 is put back the way it was, not just set.
+;--
+_TIMER_TICK:
+	MOV	TH0, #TICK_RELOAD	; reload the tick (TL0 keeps counting!)
+	PUSH	PSW			; save the flags (MOV A changes P!)
+	PUSH	ACC			; and the ACC
+	INC	_g_wTicks		; increment the low byte of the count
+	MOV	A, _g_wTicks		; did it wrap around?
+	JNZ	TICK1			; no
+	INC	_g_wTicks+1		; yes - increment the high byte too
+TICK1:	JNB	m_fKeyBusy, TICK2	; quit now if the keyboard isn't busy
+	DJNZ	m_bKeyTimer, TICK2	; and quit if the timeout hasn't expired
+	MOV	C, EX0			; remember whether INT0 was enabled
+	CLR	EX0			; no keyboard interrupts now
+	JNB	m_fKeyBusy, TICK3	; did the stop bit just show up after all?
+	SETB	m_fKeyTimeout		; no - set the timeout flag
 	CLR	m_fKeyBusy		; clear the busy flag
 	MOV	m_bKeyState, #0		; and reset to state zero
+TICK3:	MOV	EX0, C			; put INT0 back the way it was
+TICK2:	POP	ACC			; restore the ACC
+	POP	PSW			; and the flags
 	RETI				; and return
-
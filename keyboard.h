@@ -23,16 +23,41 @@
 // dd-mmm-yy    who     description
 //  5-Feb-06	RLA	New file.
 // 12-May-24	RLA	Use stdint and update for SDCC.
+// 16-Oct-26	RLA	Add the timer 0 system tick.
+//			Add GetCycles().
+//			Define the individual error bits.
+// 16-Oct-26	RLA	Add PowerDown().
+// 16-Oct-26	RLA	Add InjectKey().
 //--
 #pragma once
 
-#define KEYBOARD_ERROR_BITS	0xF0
+// Error bits in g_bKeyFlags (these must agree with keyboard.asm!) ...
+#define KEYBOARD_OVERFLOW	0x10	// keyboard buffer overflow
+#define KEYBOARD_PARITY		0x20	// parity error
+#define KEYBOARD_FRAMING	0x40	// bad start or stop bit
+#define KEYBOARD_TIMEOUT	0x80	// byte didn't finish in time
+#define KEYBOARD_ERROR_BITS	0xF0	// any of the above
+
+//   Timer 0 is a free running system tick of 1024 machine cycles (the
+// TICK_RELOAD in keyboard.asm must agree!), which is about 0.86ms with the
+// usual 14.318MHz crystal ...
+#define TICK_CYCLES		1024
+#define TICKS_PER_SECOND	((uint16_t) (CPUCLOCK / 12UL / TICK_CYCLES))
+#define MS_TO_TICKS(ms)		((uint16_t) (((ms) * (CPUCLOCK / 12UL / TICK_CYCLES)) / 1000UL))
 
 // Function prototypes...
 extern void InitializeKeyboard (void);
 extern int GetKey (void);
+extern void InhibitKeyboard (void);
+extern void ReleaseKeyboard (void);
+extern uint8_t PowerDown (void);
+extern void InjectKey (uint8_t bKey);
+extern void InitializeTimer (void);
+extern uint16_t GetTicks (void);
+extern uint16_t GetCycles (void);
 extern void KEYBOARD_BIT (void) __interrupt (0);
-extern void KEYBOARD_TIMEOUT (void) __interrupt (1);
+extern void TIMER_TICK (void) __interrupt (1);
 
 // Global data definitions...
 extern volatile uint8_t __data g_bKeyFlags;
+extern volatile uint16_t __data g_wTicks;
@@ -0,0 +1,609 @@
+//++
+//mklayout.c - compile a keyboard layout description into a scancode table
+//
+// Copyright (C) 2006-2024 by Spare Time Gizmos.  All rights reserved.
+//
+// This file is part of the Spare Time Gizmos' VT1802 and VIS1802 firmware.
+//
+// This firmware is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+// Place, Suite 330, Boston, MA  02111-1307  USA.
+//
+// DESCRIPTION:
+//   This is a HOST side program (i.e. it's compiled with the host's native C
+// compiler, NOT with SDCC!) that reads a keyboard layout description file,
+// layout_xx.kbd, and generates the corresponding scancode_xx.c file for the
+// APU firmware.  The scancode_xx.c files are checked in, and "make layouts"
+// runs this to regenerate all of them after a layout file changes.  The
+// combined table for several layouts isn't checked in, and the Makefile runs
+// this for it as part of the normal build.
+//
+//   A layout description is a plain text file with one line for every PS/2
+// scan code that produces an ASCII character.  Each line contains the scan
+// code (in hex), the four characters for the unshifted, shifted, control and
+// control-shift states, and an optional description of the key -
+//
+//	#code	normal	shift	control	ctl-shf	description
+//	15	'q'	'Q'	0x11	-	Q
+//
+// Characters may be written as a quoted character ('q', '\\' or '\''), as a
+// hex (0x11) or decimal (17) number, or as "-" if the key sends nothing in
+// that state.  Anything after a "#" (outside of quotes!) is a comment.  The
+// characters are ISO 8859-1 (Latin-1), and a quoted Latin-1 character may
+// be written in UTF-8 (e.g. 'ä'), which is what most editors will give you.
+//
+//   A layout may start from another layout with a "base xx" line, in which
+// case the base layout (layout_xx.kbd in the same directory) is read first and
+// this file need only list the keys that are different.  A "name" line gives
+// the name of the layout, which is used in the generated file's header.
+//
+//   With the default CHARSET the firmware sends the ISO 646 national variant
+// codes for Latin-1 characters, and most of those are the same in every
+// variant that has them.  An "iso646 'x' 'y'" line gives the code, y, for a
+// character, x, that only this layout's national variant has (e.g. "§" is
+// "@" in German) - these go into g_abLayoutISO646[] for that layout.
+//
+//   Before writing anything the table is checked for -
+//
+//	* the same scan code defined more than once in one file (error),
+//	* codes 0x81..0x9F, which aren't Latin-1 characters (warning, or an
+//	  error if there's more than one layout),
+//	* two keys that send the same character in the same shift state
+//	  (warning), and
+//	* characters assigned to keys that host.c handles before it ever looks
+//	  at this table (warning - they can never be typed).
+//
+//   Errors prevent the output file from being written.  The -w option makes
+// warnings fatal as well.
+//
+//   If more than one layout file is given, then ALL the layouts are put in one
+// table and the firmware can switch between them at runtime.  The first
+// layout is the base, and g_abScanCodes[] is generated from it just as usual,
+// except that any character that's not the same in every layout is replaced
+// by LAYOUT_DELTA+n.  That's an index into g_apbLayoutDeltas[], which holds,
+// for each layout, the n'th "delta" row of four characters for that layout.
+// The LAYOUT_DELTA codes are 0x81..0x9F, which are never valid characters.
+//
+// USAGE:
+//	mklayout [-w] [-o scancode_xx.c] layout_xx.kbd [layout_yy.kbd ...]
+//
+//REVISION HISTORY:
+// dd-mmm-yy    who     description
+// 16-Oct-26	RLA	New file.
+// 16-Oct-26	RLA	Allow several layouts in one table.
+// 16-Oct-26	RLA	Allow Latin-1 characters.
+// 16-Oct-26	RLA	Add "iso646".
+// 16-Oct-26	RLA	Say "make layouts" in the generated file.
+//--
+#include <stdio.h>		// printf(), fopen(), et al ...
+#include <stdlib.h>		// exit(), strtoul() ...
+#include <stdint.h>		// uint8_t, et al ...
+#include <stdbool.h>		// bool, true, false ...
+#include <string.h>		// strcpy(), strrchr(), ...
+#include <ctype.h>		// isspace(), isxdigit(), ...
+
+// Limits ...
+#define MAXCODE		128	// number of rows in g_abScanCodes[]
+#define MAXPLANE	4	// and number of shift states per row
+#define MAXLINE		256	// longest line in a layout file
+#define MAXNAME		64	// longest key or layout name
+#define MAXDEPTH	8	// deepest nesting of "base" layouts
+#define MAXLAYOUT	8	// most layouts in one table
+
+// Special character values (see DoASCII() in host.c) ...
+#define CH_NUL		0x80	// sends a NUL (e.g. CONTROL-SHIFT-@)
+#define CH_LATIN1	0xA0	// first Latin-1 character
+#define LAYOUT_DELTA	0x81	// first delta row index (see scancode.h)
+#define MAXDELTAS	31	// number of delta row indices (0x81..0x9F)
+#define MAXISO646	2	// ISO 646 codes per layout (LAYOUT_ISO646)
+
+// One row of the scancode table ...
+typedef struct {
+  uint8_t  abCodes[MAXPLANE];	// characters for each shift state
+  char     szName[MAXNAME];	// description of this key
+  char     szFile[MAXNAME];	// layout file that last defined it
+  int      nLine;		//  ... and the line number there
+} ROW;
+
+// One complete layout ...
+typedef struct {
+  ROW      aRows[MAXCODE];	// the scancode table for this layout
+  char     szName[MAXNAME];	// name of the layout
+  uint8_t  abISO646[MAXISO646][2]; // ISO 646 codes for this layout
+  int      nISO646;		//  ... and the number of them
+  const char *pszFile;		// and the file it came from
+} LAYOUT;
+
+// Global data ...
+static LAYOUT g_aLayouts[MAXLAYOUT];	// all the layouts being built
+static int  g_nLayouts  = 0;		// number of layouts read
+static int  g_nErrors   = 0;		// number of errors found
+static int  g_nWarnings = 0;		// number of warnings found
+
+// Names of the shift states, for messages ...
+static const char *const g_apszPlanes[MAXPLANE] =
+  {"normal", "shift", "control", "control-shift"};
+
+//++
+//   These are the scan codes that ConvertKeys() in host.c handles itself
+// before it ever calls DoASCII(), so any characters assigned to them in the
+// layout can never be typed.  This list MUST agree with host.c!
+//--
+static const uint8_t g_abUnreachable[] = {
+  0x00,						// keyboard error (DoSpecial)
+  0x11, 0x12, 0x14, 0x58, 0x59,			// ALT, SHIFTs, CTRL, CAPS LOCK
+  0x01, 0x03, 0x04, 0x05, 0x06, 0x07,		// F9, F5, F3, F1, F2, F12
+  0x09, 0x0A, 0x0B, 0x0C, 0x78,			// F10, F8, F6, F4, F11
+  0x69, 0x6B, 0x6C, 0x70, 0x71, 0x72, 0x73,	// numeric keypad ...
+  0x74, 0x75, 0x79, 0x7A, 0x7B, 0x7C, 0x7D,	//  ...
+  0x77, 0x7E,					// NUM LOCK, SCROLL LOCK
+};
+
+
+//++
+// Print an error or warning message with the file name and line number ...
+//--
+static void Error (const char *pszFile, int nLine, const char *pszMsg, const char *pszArg)
+{
+  fprintf(stderr, "%s:%d: error: ", pszFile, nLine);
+  fprintf(stderr, pszMsg, pszArg);  fputc('\n', stderr);
+  ++g_nErrors;
+}
+
+static void Warning (const ROW *pRow, uint8_t bCode, int nPlane, const char *pszMsg, unsigned nArg)
+{
+  fprintf(stderr, "%s:%d: warning: key %02X (%s) %s: ", pRow->szFile,
+    pRow->nLine, bCode, pRow->szName, g_apszPlanes[nPlane]);
+  fprintf(stderr, pszMsg, nArg);  fputc('\n', stderr);
+  ++g_nWarnings;
+}
+
+
+//++
+//   Extract the next whitespace delimited token from a line.  Quoted characters
+// are returned as a single token (quotes and all) even if they contain spaces
+// or a "#".  Returns NULL at the end of the line or at the start of a comment.
+//--
+static char *NextToken (char **ppsz)
+{
+  char *p = *ppsz, *pszToken;
+  while (isspace((unsigned char) *p)) ++p;
+  if ((*p == '\0') || (*p == '#')) return NULL;
+  pszToken = p;
+  if (*p == '\'') {
+    //   Skip the quote, an optional backslash, the character (which may be
+    // a two byte UTF-8 sequence) and the quote ...
+    ++p;  if (*p == '\\') ++p;
+    if (*p != '\0') ++p;
+    if ((*p & 0xC0) == 0x80) ++p;
+    if (*p == '\'') ++p;
+  } else {
+    while ((*p != '\0') && !isspace((unsigned char) *p)) ++p;
+  }
+  if (*p != '\0') *p++ = '\0';
+  *ppsz = p;
+  return pszToken;
+}
+
+
+//++
+//   Convert a character token ('x', '\\', 0x12, 18 or -) to its value.  Returns
+// false if the token is not a valid character.
+//--
+static bool ParseChar (const char *pszToken, uint8_t *pbValue)
+{
+  char *pszEnd;  unsigned long lValue;  const uint8_t *pbUTF8;
+  if (strcmp(pszToken, "-") == 0) {
+    *pbValue = 0;  return true;
+  }
+  if (pszToken[0] == '\'') {
+    if ((pszToken[1] == '\\') && (pszToken[3] == '\'') && (pszToken[4] == '\0')) {
+      if ((pszToken[2] != '\\') && (pszToken[2] != '\'')) return false;
+      *pbValue = (uint8_t) pszToken[2];  return true;
+    }
+    if ((pszToken[1] != '\0') && (pszToken[2] == '\'') && (pszToken[3] == '\0')) {
+      *pbValue = (uint8_t) pszToken[1];  return true;
+    }
+    //   Latin-1 characters in UTF-8 are two bytes, 0xC2 or 0xC3 and then one
+    // continuation byte ...
+    pbUTF8 = (const uint8_t *) pszToken;
+    if (((pbUTF8[1] & 0xFE) == 0xC2) && ((pbUTF8[2] & 0xC0) == 0x80)
+     && (pbUTF8[3] == '\'') && (pbUTF8[4] == '\0')) {
+      *pbValue = (uint8_t) (((pbUTF8[1] & 0x03) << 6) | (pbUTF8[2] & 0x3F));
+      return true;
+    }
+    return false;
+  }
+  lValue = strtoul(pszToken, &pszEnd, 0);
+  if ((*pszEnd != '\0') || (lValue > 0xFF)) return false;
+  *pbValue = (uint8_t) lValue;
+  return true;
+}
+
+
+//++
+//   Read one layout description file and add its definitions to the layout.
+// If the file has a "base" line, then the base layout is read (recursively)
+// first.
+//--
+static void ReadLayout (LAYOUT *pLayout, const char *pszFile, int nDepth)
+{
+  FILE *f;  char szLine[MAXLINE];  int nLine = 0;
+  bool afDefined[MAXCODE] = {false};  bool fAnyKeys = false;
+
+  if (nDepth > MAXDEPTH) {
+    Error(pszFile, 0, "base layouts nested too deeply%s", "");  return;
+  }
+  if ((f = fopen(pszFile, "rt")) == NULL) {
+    Error(pszFile, 0, "can't open layout file%s", "");  return;
+  }
+
+  while (fgets(szLine, sizeof(szLine), f) != NULL) {
+    char *p = szLine, *pszToken;
+    ++nLine;
+    szLine[strcspn(szLine, "\r\n")] = '\0';
+    if ((pszToken = NextToken(&p)) == NULL) continue;
+
+    if (strcmp(pszToken, "name") == 0) {
+      // "name" - the rest of the line is the name of this layout ...
+      while (isspace((unsigned char) *p)) ++p;
+      if ((nDepth == 0) || (pLayout->szName[0] == '\0'))
+        strncpy(pLayout->szName, p, MAXNAME-1);
+    } else if (strcmp(pszToken, "base") == 0) {
+      // "base xx" - read layout_xx.kbd from the same directory first ...
+      char szBase[MAXLINE];  const char *pszSlash;  size_t cbDir;
+      if (fAnyKeys) {
+        Error(pszFile, nLine, "\"base\" must come before any keys%s", "");
+        continue;
+      }
+      if ((pszToken = NextToken(&p)) == NULL) {
+        Error(pszFile, nLine, "missing base layout name%s", "");  continue;
+      }
+      pszSlash = strrchr(pszFile, '/');
+      cbDir = (pszSlash == NULL) ? 0 : (size_t) (pszSlash - pszFile + 1);
+      snprintf(szBase, sizeof(szBase), "%.*slayout_%s.kbd", (int) cbDir, pszFile, pszToken);
+      ReadLayout(pLayout, szBase, nDepth+1);
+    } else if (strcmp(pszToken, "iso646") == 0) {
+      // "iso646 'x' 'y'" - Latin-1 character x is sent as y ...
+      uint8_t bChar, bCode;  int i;
+      if (((pszToken = NextToken(&p)) == NULL) || !ParseChar(pszToken, &bChar)
+       || (bChar < CH_LATIN1) || ((pszToken = NextToken(&p)) == NULL)
+       || !ParseChar(pszToken, &bCode) || (bCode == 0) || (bCode >= CH_NUL)) {
+        Error(pszFile, nLine, "invalid ISO 646 character%s", "");  continue;
+      }
+      for (i = 0;  (i < pLayout->nISO646) && (pLayout->abISO646[i][0] != bChar);  ++i) ;
+      if (i >= MAXISO646) {
+        Error(pszFile, nLine, "too many ISO 646 characters%s", "");  continue;
+      }
+      pLayout->abISO646[i][0] = bChar;  pLayout->abISO646[i][1] = bCode;
+      if (i == pLayout->nISO646) ++pLayout->nISO646;
+    } else {
+      // Anything else must be a scan code and four characters ...
+      char *pszEnd;  unsigned long lCode;  uint8_t abCodes[MAXPLANE];  int i;
+      ROW *pRow;
+      lCode = strtoul(pszToken, &pszEnd, 16);
+      if ((*pszEnd != '\0') || !isxdigit((unsigned char) *pszToken)) {
+        Error(pszFile, nLine, "unknown keyword \"%s\"", pszToken);  continue;
+      }
+      if (lCode >= MAXCODE) {
+        Error(pszFile, nLine, "scan code %s is out of range", pszToken);  continue;
+      }
+      for (i = 0;  i < MAXPLANE;  ++i) {
+        if ((pszToken = NextToken(&p)) == NULL) break;
+        if (!ParseChar(pszToken, &abCodes[i])) break;
+      }
+      if (i < MAXPLANE) {
+        Error(pszFile, nLine, (pszToken == NULL) ? "missing character%s"
+          : "invalid character \"%s\"", (pszToken == NULL) ? "" : pszToken);
+        continue;
+      }
+      if (afDefined[lCode]) {
+        char szCode[8];  snprintf(szCode, sizeof(szCode), "%02lX", lCode);
+        Error(pszFile, nLine, "scan code %s is defined more than once", szCode);
+        continue;
+      }
+      afDefined[lCode] = fAnyKeys = true;
+      pRow = &pLayout->aRows[lCode];
+      memcpy(pRow->abCodes, abCodes, sizeof(abCodes));
+      while (isspace((unsigned char) *p)) ++p;
+      p[strcspn(p, "#")] = '\0';
+      for (i = (int) strlen(p);  (i > 0) && isspace((unsigned char) p[i-1]);  --i) ;
+      p[i] = '\0';
+      if ((*p != '\0') || (pRow->szName[0] == '\0'))
+        strncpy(pRow->szName, p, MAXNAME-1);
+      strncpy(pRow->szFile, pszFile, MAXNAME-1);
+      pRow->nLine = nLine;
+    }
+  }
+  fclose(f);
+}
+
+
+//++
+// Check the finished table for collisions, duplicates and unreachable keys ...
+//--
+static void CheckLayout (const LAYOUT *pLayout)
+{
+  const ROW *aRows = pLayout->aRows;
+  bool afUnreachable[MAXCODE] = {false};
+  unsigned i, j;  int nPlane;
+
+  for (i = 0;  i < sizeof(g_abUnreachable);  ++i)
+    afUnreachable[g_abUnreachable[i]] = true;
+
+  for (i = 0;  i < MAXCODE;  ++i) {
+    for (nPlane = 0;  nPlane < MAXPLANE;  ++nPlane) {
+      uint8_t bCode = aRows[i].abCodes[nPlane];
+      if (bCode == 0) continue;
+      if (afUnreachable[i]) {
+        Warning(&aRows[i], i, nPlane, "0x%02X can never be typed", bCode);
+        continue;
+      }
+      if ((g_nLayouts > 1) && (bCode >= LAYOUT_DELTA) && (bCode < LAYOUT_DELTA+MAXDELTAS)) {
+        fprintf(stderr, "%s:%d: error: key %02X (%s) %s: 0x%02X can't be used"
+          " with more than one layout\n", aRows[i].szFile, aRows[i].nLine, i,
+          aRows[i].szName, g_apszPlanes[nPlane], bCode);
+        ++g_nErrors;
+      } else if ((bCode > CH_NUL) && (bCode < CH_LATIN1))
+        Warning(&aRows[i], i, nPlane,
+          "0x%02X is not a Latin-1 character", bCode);
+      for (j = i+1;  j < MAXCODE;  ++j) {
+        if (afUnreachable[j] || (aRows[j].abCodes[nPlane] != bCode)) continue;
+        fprintf(stderr, "%s:%d: warning: keys %02X (%s) and %02X (%s) both"
+          " send 0x%02X when %s\n", aRows[j].szFile, aRows[j].nLine, i,
+          aRows[i].szName, j, aRows[j].szName, bCode, g_apszPlanes[nPlane]);
+        ++g_nWarnings;
+      }
+    }
+  }
+}
+
+
+//++
+//   Format one character for the generated table.  Printing characters are
+// written as C character constants and everything else as hex.
+//--
+static const char *FormatChar (uint8_t bCode)
+{
+  static char szBuffer[8];
+  if (bCode == 0)
+    strcpy(szBuffer, "0");
+  else if (bCode == '\\')
+    strcpy(szBuffer, "'\\\\'");
+  else if ((bCode > ' ') && (bCode < 0x7F) && (bCode != '\''))
+    snprintf(szBuffer, sizeof(szBuffer), "'%c'", bCode);
+  else
+    snprintf(szBuffer, sizeof(szBuffer), "0x%02X", bCode);
+  return szBuffer;
+}
+
+
+//++
+//   Combine all the layouts into one table.  Any character that's not the same
+// in every layout is replaced by LAYOUT_DELTA plus the index of that row in
+// the delta tables, and the row number is saved in abDeltaRows[].  Returns
+// the number of delta rows, or -1 if there are too many.
+//--
+static int BuildDeltas (ROW aTable[], uint8_t abDeltaRows[])
+{
+  int nDeltas = 0, nLayout, nPlane;  unsigned i;
+  memcpy(aTable, g_aLayouts[0].aRows, MAXCODE*sizeof(ROW));
+  for (i = 0;  i < MAXCODE;  ++i) {
+    bool fDelta = false;
+    for (nPlane = 0;  nPlane < MAXPLANE;  ++nPlane) {
+      for (nLayout = 1;  nLayout < g_nLayouts;  ++nLayout) {
+        if (g_aLayouts[nLayout].aRows[i].abCodes[nPlane] != aTable[i].abCodes[nPlane]) break;
+      }
+      if (nLayout == g_nLayouts) continue;
+      if (nDeltas >= MAXDELTAS) return -1;
+      aTable[i].abCodes[nPlane] = (uint8_t) (LAYOUT_DELTA + nDeltas);
+      fDelta = true;
+    }
+    if (fDelta) abDeltaRows[nDeltas++] = (uint8_t) i;
+  }
+  return nDeltas;
+}
+
+
+//++
+// Write the scancode_xx.c file ...
+//--
+static void WriteTable (FILE *f, const char *pszOutput, char *apszInputs[])
+{
+  ROW aTable[MAXCODE];  uint8_t abDeltaRows[MAXDELTAS];
+  const char *pszBase;  unsigned i;  int nPlane, nLayout, nDeltas = 0;
+  char szInputs[MAXLINE] = "";
+
+  for (nLayout = 0;  nLayout < g_nLayouts;  ++nLayout) {
+    pszBase = strrchr(apszInputs[nLayout], '/');
+    pszBase = (pszBase == NULL) ? apszInputs[nLayout] : pszBase+1;
+    if (nLayout > 0) strncat(szInputs, ", ", sizeof(szInputs)-strlen(szInputs)-1);
+    strncat(szInputs, pszBase, sizeof(szInputs)-strlen(szInputs)-1);
+  }
+  if (g_nLayouts > 1)
+    nDeltas = BuildDeltas(aTable, abDeltaRows);
+  else
+    memcpy(aTable, g_aLayouts[0].aRows, sizeof(aTable));
+
+  pszBase = strrchr(pszOutput, '/');  pszBase = (pszBase == NULL) ? pszOutput : pszBase+1;
+  fprintf(f, "//++\n");
+  fprintf(f, "//%s - PS/2 scan codes to ASCII translation table (%s", pszBase, g_aLayouts[0].szName);
+  for (nLayout = 1;  nLayout < g_nLayouts;  ++nLayout)
+    fprintf(f, ", %s", g_aLayouts[nLayout].szName);
+  fprintf(f, ")\n");
+  fprintf(f, "//\n");
+  fprintf(f, "//   *** THIS FILE WAS GENERATED BY MKLAYOUT FROM %s - DON'T EDIT IT! ***\n", szInputs);
+  fprintf(f, "//\n");
+  fprintf(f, "// Copyright (C) 2006-2024 by Spare Time Gizmos.  All rights reserved.\n");
+  fprintf(f, "//\n");
+  fprintf(f, "// This file is part of the Spare Time Gizmos' VT1802 and VIS1802 firmware.\n");
+  fprintf(f, "//\n");
+  fprintf(f, "// This firmware is free software; you can redistribute it and/or modify it\n");
+  fprintf(f, "// under the terms of the GNU General Public License as published by the Free\n");
+  fprintf(f, "// Software Foundation; either version 2 of the License, or (at your option)\n");
+  fprintf(f, "// any later version.\n");
+  fprintf(f, "//\n");
+  fprintf(f, "// This program is distributed in the hope that it will be useful, but WITHOUT\n");
+  fprintf(f, "// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or\n");
+  fprintf(f, "// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for\n");
+  fprintf(f, "// more details.\n");
+  fprintf(f, "//\n");
+  fprintf(f, "// You should have received a copy of the GNU General Public License along with\n");
+  fprintf(f, "// this program; if not, write to the Free Software Foundation, Inc., 59 Temple\n");
+  fprintf(f, "// Place, Suite 330, Boston, MA  02111-1307  USA\n");
+  fprintf(f, "//\n");
+  fprintf(f, "// DESCRIPTION:\n");
+  fprintf(f, "//   This module contains a table for translating PS/2 keyboard scan codes into\n");
+  fprintf(f, "// ASCII characters.  Each scan code has four table entries, corresponding to\n");
+  fprintf(f, "// the unshifted, shifted, control, and control-shift modifier states.  To\n");
+  fprintf(f, "// change it, edit %s and run \"%s\".\n", szInputs,
+    (g_nLayouts > 1) ? "make" : "make layouts");
+  fprintf(f, "//--\n");
+  fprintf(f, "#include <stdint.h>\t\t// uint8_t, et al ...\n");
+  fprintf(f, "#include \"ps2apu.h\"\t\t// declarations for this project\n");
+  fprintf(f, "#include \"scancode.h\"\t\t// prototypes for this module\n");
+  if (g_nLayouts > 1) {
+    fprintf(f, "#if LAYOUT_COUNT != %d\n", g_nLayouts);
+    fprintf(f, "#error LAYOUT_COUNT does not match the number of layouts in this table!\n");
+    fprintf(f, "#endif\n");
+  }
+  fprintf(f, "\n\n");
+  fprintf(f, "//++\n");
+  fprintf(f, "//   The first index in this table is, of course, the scan code from the\n");
+  fprintf(f, "// IBM AT/PS2 keyboard.  The second index is the shift/control state as\n");
+  fprintf(f, "// follows:\n");
+  fprintf(f, "//\n");
+  fprintf(f, "//\tSHIFT\tCONTROL     Index\n");
+  fprintf(f, "//\t NO\t  NO\t      0\n");
+  fprintf(f, "//\t YES\t  NO\t      1\n");
+  fprintf(f, "//\t NO\t  YES\t      2\n");
+  fprintf(f, "//\t YES\t  YES\t      3\n");
+  if (g_nLayouts > 1) {
+    fprintf(f, "//\n");
+    fprintf(f, "// Entries from LAYOUT_DELTA to LAYOUT_DELTA+%d are different in each layout\n", nDeltas-1);
+    fprintf(f, "// and index the delta rows in g_apbLayoutDeltas[] below.\n");
+  }
+  fprintf(f, "//--\n");
+  fprintf(f, "PUBLIC uint8_t const __code g_abScanCodes[%d][%d] = {\n", MAXCODE, MAXPLANE);
+  for (i = 0;  i < MAXCODE;  ++i) {
+    fprintf(f, "  {");
+    for (nPlane = 0;  nPlane < MAXPLANE;  ++nPlane)
+      fprintf(f, "%6s%s", FormatChar(aTable[i].abCodes[nPlane]), (nPlane < MAXPLANE-1) ? "," : "");
+    fprintf(f, "}%s\t// %02X", (i < MAXCODE-1) ? "," : " ", i);
+    if (aTable[i].szName[0] != '\0') fprintf(f, " - %s", aTable[i].szName);
+    fprintf(f, "\n");
+  }
+  fprintf(f, "};\n");
+
+  fprintf(f, "\n\n");
+  fprintf(f, "//++\n");
+  fprintf(f, "//   These are the ISO 646 codes for Latin-1 characters that only this\n");
+  fprintf(f, "// layout's national variant has (see SendChar() in host.c).  The first\n");
+  fprintf(f, "// index is the layout number, and unused entries are zero.\n");
+  fprintf(f, "//--\n");
+  fprintf(f, "PUBLIC uint8_t const __code g_abLayoutISO646[LAYOUT_COUNT][LAYOUT_ISO646][2] = {\n");
+  for (nLayout = 0;  nLayout < g_nLayouts;  ++nLayout) {
+    const LAYOUT *pLayout = &g_aLayouts[nLayout];
+    fprintf(f, "  {");
+    for (i = 0;  i < MAXISO646;  ++i) {
+      uint8_t bChar = 0, bCode = 0;
+      if ((int) i < pLayout->nISO646) {
+        bChar = pLayout->abISO646[i][0];  bCode = pLayout->abISO646[i][1];
+      }
+      fprintf(f, "{%s, ", FormatChar(bChar));
+      fprintf(f, "%s}%s", FormatChar(bCode), (i < MAXISO646-1) ? ", " : "");
+    }
+    fprintf(f, "}%s\t// %d - %s\n", (nLayout < g_nLayouts-1) ? "," : " ", nLayout, pLayout->szName);
+  }
+  fprintf(f, "};\n");
+  if (g_nLayouts == 1) return;
+
+  fprintf(f, "\n\n");
+  fprintf(f, "//++\n");
+  fprintf(f, "//   These are the delta rows for each layout.  The first index is the layout\n");
+  fprintf(f, "// number, the second is the LAYOUT_DELTA code from g_abScanCodes[] (less\n");
+  fprintf(f, "// LAYOUT_DELTA, of course!) and the third is the shift/control state.\n");
+  fprintf(f, "//--\n");
+  fprintf(f, "PRIVATE uint8_t const __code m_abLayoutDeltas[%d][%d][%d] = {\n", g_nLayouts, nDeltas, MAXPLANE);
+  for (nLayout = 0;  nLayout < g_nLayouts;  ++nLayout) {
+    fprintf(f, "  {\t// %d - %s\n", nLayout, g_aLayouts[nLayout].szName);
+    for (i = 0;  i < (unsigned) nDeltas;  ++i) {
+      const ROW *pRow = &g_aLayouts[nLayout].aRows[abDeltaRows[i]];
+      fprintf(f, "    {");
+      for (nPlane = 0;  nPlane < MAXPLANE;  ++nPlane)
+        fprintf(f, "%6s%s", FormatChar(pRow->abCodes[nPlane]), (nPlane < MAXPLANE-1) ? "," : "");
+      fprintf(f, "}%s\t// %02X", (i < (unsigned) nDeltas-1) ? "," : " ", abDeltaRows[i]);
+      if (pRow->szName[0] != '\0') fprintf(f, " - %s", pRow->szName);
+      fprintf(f, "\n");
+    }
+    fprintf(f, "  }%s\n", (nLayout < g_nLayouts-1) ? "," : "");
+  }
+  fprintf(f, "};\n");
+  fprintf(f, "PUBLIC uint8_t const __code * const __code g_apbLayoutDeltas[LAYOUT_COUNT] = {\n");
+  for (nLayout = 0;  nLayout < g_nLayouts;  ++nLayout)
+    fprintf(f, "  m_abLayoutDeltas[%d][0]%s\n", nLayout, (nLayout < g_nLayouts-1) ? "," : "");
+  fprintf(f, "};\n");
+}
+
+
+//++
+// Main program ...
+//--
+int main (int argc, char *argv[])
+{
+  const char *pszOutput = NULL;  char *apszInputs[MAXLAYOUT];
+  bool fWarningsFatal = false;  FILE *f;  int i, nLayout;
+  ROW aTable[MAXCODE];  uint8_t abDeltaRows[MAXDELTAS];
+
+  for (i = 1;  i < argc;  ++i) {
+    if (strcmp(argv[i], "-w") == 0)
+      fWarningsFatal = true;
+    else if ((strcmp(argv[i], "-o") == 0) && (i+1 < argc))
+      pszOutput = argv[++i];
+    else if ((argv[i][0] != '-') && (g_nLayouts < MAXLAYOUT))
+      apszInputs[g_nLayouts++] = argv[i];
+    else {
+      g_nLayouts = 0;  break;
+    }
+  }
+  if (g_nLayouts == 0) {
+    fprintf(stderr, "usage: mklayout [-w] [-o scancode_xx.c] layout_xx.kbd [layout_yy.kbd ...]\n");
+    return EXIT_FAILURE;
+  }
+
+  for (nLayout = 0;  nLayout < g_nLayouts;  ++nLayout) {
+    g_aLayouts[nLayout].pszFile = apszInputs[nLayout];
+    ReadLayout(&g_aLayouts[nLayout], apszInputs[nLayout], 0);
+    if (g_nErrors == 0) CheckLayout(&g_aLayouts[nLayout]);
+  }
+  if ((g_nErrors == 0) && (g_nLayouts > 1) && (BuildDeltas(aTable, abDeltaRows) < 0)) {
+    fprintf(stderr, "error: more than %d keys are different in these layouts\n", MAXDELTAS);
+    ++g_nErrors;
+  }
+  if ((g_nErrors > 0) || (fWarningsFatal && (g_nWarnings > 0))) {
+    fprintf(stderr, "%d error(s), %d warning(s) - no output written\n", g_nErrors, g_nWarnings);
+    return EXIT_FAILURE;
+  }
+
+  if (pszOutput == NULL) {
+    WriteTable(stdout, "scancode.c", apszInputs);
+  } else {
+    if ((f = fopen(pszOutput, "wt")) == NULL) {
+      fprintf(stderr, "%s: can't create file\n", pszOutput);
+      return EXIT_FAILURE;
+    }
+    WriteTable(f, pszOutput, apszInputs);
+    fclose(f);
+  }
+  return EXIT_SUCCESS;
+}
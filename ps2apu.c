@@ -24,12 +24,20 @@
 //  4-Feb-06    RLA     New file.
 // 11-May-24	RLA	Make ROMSIZE and checksum optional.
 //			Update copyright.
+// 16-Oct-26	RLA	Add the PASSTHROUGH option.
+//			Start the timer 0 system tick.
+//			Add HOST_UART.
+// 16-Oct-26	RLA	Interrupt driven debug output.
+//			Send a TR_START trace record instead of the banner.
+// 16-Oct-26	RLA	Start the keyboard first and send KEY_VERSION right away.
+// 16-Oct-26	RLA	Don't send KEY_VERSION in the PASSTHROUGH event mode.
+// 16-Oct-26	RLA	Trace TR_START before the version number goes out.
 //--
-#include <stdio.h>		// needed so DBGOUT(()) can find printf!
 #include <stdint.h>		// uint8_t, et al ...
 #include <stdbool.h>		// bool, true, false ...
 #include "at89x051.h"		// register definitions for the AT89C2051
 #include "ps2apu.h"		// definitions for this project
+#include "trace.h"		// TR_xxx trace event codes
 #include "debug.h"		// debuging (serial port output) routines
 #include "keyboard.h"		// low level keyboard serial I/O functions
 #include "scancode.h"		// PS2 scan codes to ASCII translation table
@@ -37,8 +45,8 @@
 
 
 //   This is the copyright notice, version, and date for the software in plain
-// ASCII.  Even though this only gets printed out in the debug version, it's
-// always included to identify the ROM's contents...
+// ASCII.  Nothing prints it any more, but it's always included to identify
+// the ROM's contents...
 PUBLIC char const __code g_szFirmware[] =
   "PS2 Keyboard Interface " __DATE__ " " __TIME__;
 PUBLIC char const __code g_szCopyright[] =
@@ -50,26 +58,61 @@ PUBLIC char const __code g_szCopyright[] =
 //--
 void main (void)
 {
-  // Reset the key data ready strobe to the inactive level ...
+#ifdef DEBUG
+  uint16_t wReady;
+#endif
+
+  //   Reset the key data ready strobe to the inactive level, or if the host is
+  // connected to the UART then set that up instead ...
+#if HOST_UART
+  InitializeSerial();  ES = 1;
+#else
   SET_KEY_DATA_RDY = !STROBE_ACT_LVL;
+#endif
+
+  //   Start the system tick and the PS/2 keyboard interface and enable
+  // interrupts before anything else, so nothing the keyboard sends is lost
+  // while we do the rest.  The keyboard is never reset or configured (we can't
+  // talk to it) so it's ready to go as soon as it finishes its own BAT ...
+  InitializeTimer();  InitializeKeyboard();
+  INT_ON;  LED_ON;
 
-  //   If debugging is enabled, initialize the serial port and print the
-  // copyright notice.
+  //   If debugging is enabled, initialize the serial port and enable its
+  // interrupt before anything can send a trace record, so the debug output is
+  // interrupt driven from the start and never holds us up.  wReady is the
+  // number of machine cycles from starting the tick until the keyboard was
+  // listening - add a few hundred for the C startup code that clears RAM - and
+  // it's sent as TR_READY.  WaitKey() sends TR_FIRST_KEY with the tick count
+  // when the first keyboard byte arrives ...
 #ifdef DEBUG
-  InitializeDebugSerial();
-  DBGOUT(("\n\n%s V%d\n%s\n", g_szFirmware, VERSION, g_szCopyright));
-  DBGOUT(("Swap=%d, Strobe=%d\n\n", SWAP_CAPSLOCK_AND_CONTROL, STROBE_ACT_LVL));
+  wReady = GetCycles();
+  InitializeSerial();  ES = 1;
 #endif
 
-  // Initialize the PS/2 keyboard interface and enable interrupts ...
-  InitializeKeyboard();
-  INT_ON;  LED_ON;
+  //   TR_START goes first, so that the trace starts with it and not with the
+  // TR_HOST for the version number ...
+#ifdef DEBUG
+  TRACE2(TR_START, VERSION, (SWAP_CAPSLOCK_AND_CONTROL ? TR_START_SWAP : 0)
+    | (STROBE_ACT_LVL ? TR_START_STROBE : 0));
+  TRACE2(TR_READY, HIBYTE(wReady), LOBYTE(wReady));
+#endif
 
-  // Whenever the APU is restarted we always send our version number.
+  //   Whenever the APU is restarted we always send our version number.  This
+  // just puts it in the host FIFO, so it never waits for the host.  The one
+  // exception is the PASSTHROUGH event mode, where every byte with bit 7 set
+  // is a key release and KEY_VERSION|VERSION would look just like one (e.g.
+  // 0xC4 is the release of "O") ...
+#if PASSTHROUGH != PASSTHROUGH_EVENTS
   SendHost(KEY_VERSION|VERSION);
+#endif
 
-  // And then convert PS/2 keys to ASCII and send them to the host.
+  //   And then convert PS/2 keys to ASCII and send them to the host, or just
+  // pass them thru untranslated ...
+#if PASSTHROUGH != 0
+  PassthroughKeys();
+#else
   ConvertKeys();
+#endif
 
   // We should never get here, but ...
   HALT;
@@ -28,6 +28,10 @@
 //  4-Feb-06    RLA     New file.
 // 11-May-24	RLA	Add CPUCLOCK and STROBE_ACT_LVL.
 //			Make ROMSIZE and checksum optional.
+// 16-Oct-26	RLA	Add the ALTERNATE_LAYOUT jumper.
+// 16-Oct-26	RLA	Add STROBE_PULSE and STROBE_GAP.
+// 16-Oct-26	RLA	Add HOST_UART.
+// 16-Oct-26	RLA	Add IDLE.
 //--
 #pragma once
 
@@ -41,6 +45,29 @@
 #ifndef STROBE_ACT_LVL
 #define STROBE_ACT_LVL  1		// data ready strobe active level
 #endif
+//   If STROBE_PULSE is zero, then SET_KEY_DATA_RDY does the usual four phase
+// handshake with the host.  Otherwise it's just a pulse, at least STROBE_PULSE
+// machine cycles wide, for hosts that latch the data on the strobe edge, and
+// there are at least STROBE_GAP machine cycles between pulses.  Both are timed
+// with TL0, so they must be less than 256 ...
+#ifndef STROBE_PULSE
+#define STROBE_PULSE	0		// strobe pulse width (0 = handshake)
+#endif
+#ifndef STROBE_GAP
+#define STROBE_GAP	12		// minimum gap between pulses
+#endif
+#if (STROBE_PULSE > 255) || (STROBE_GAP > 255)
+#error STROBE_PULSE and STROBE_GAP must be less than 256
+#endif
+//   HOST_UART sends the keys to the host thru the 8051 UART instead of P1 and
+// the handshake lines.  The DEBUG version uses the UART too, so you can't have
+// both ...
+#ifndef HOST_UART
+#define HOST_UART	0		// 1 to send keys thru the UART
+#endif
+#if HOST_UART && defined(DEBUG)
+#error HOST_UART can not be used with DEBUG
+#endif
 
 // Status LED ...
 #define LED_BIT		P3_5
@@ -49,24 +76,31 @@
 
 // External options jumpers...
 //   In the non-DEBUG version, P3.0 can be used to connect an external
-// jumper to control the SWAP CAPSLOCK and CONTROL feature.  In the DEBUG
-// version P3.1 and P3.0 are TXD and RXD for the serial port, and can't be
-// used for jumpers.
+// jumper to control the SWAP CAPSLOCK and CONTROL feature, and P3.1 can be
+// used for a jumper to select the alternate (second) keyboard layout when
+// the firmware has more than one.  In the DEBUG and HOST_UART versions P3.1
+// and P3.0 are TXD and RXD for the serial port, and can't be used for jumpers.
 //
-//   In the DEBUG version you can define (with -D... on the SDCC command line)
-// the SWAP_CAPSLOCK_AND_CONTROL symbol to get any default behavior you want.
-// In the non-DEBUG version these definitions will be ignored and only the
-// jumper settings matters.
-#ifndef DEBUG
+//   In the DEBUG and HOST_UART versions you can define (with -D... on the SDCC
+// command line) the SWAP_CAPSLOCK_AND_CONTROL and ALTERNATE_LAYOUT symbols to
+// get any default behavior you want.  In the other versions these definitions
+// will be ignored and only the jumper settings matters.
+#if !defined(DEBUG) && !HOST_UART
 // Ignore any command line definitions in the non-DEBUG version ...
 #undef SWAP_CAPSLOCK_AND_CONTROL
+#undef ALTERNATE_LAYOUT
 // JP4 - caps lock/control mode (active low!)
 #define SWAP_CAPSLOCK_AND_CONTROL	(P3_0 == 0)
+// JP5 - alternate keyboard layout (active low!)
+#define ALTERNATE_LAYOUT		(P3_1 == 0)
 #else
-// Set the defaults for the DEBUG version (you can override with -D!) ...
+// Set the defaults for the serial versions (you can override with -D!) ...
 #ifndef SWAP_CAPSLOCK_AND_CONTROL
 #define SWAP_CAPSLOCK_AND_CONTROL false
 #endif
+#ifndef ALTERNATE_LAYOUT
+#define ALTERNATE_LAYOUT	false
+#endif
 #endif
 
 // Handshaking flags...
@@ -92,6 +126,10 @@
 //  (well, what else can we do in an embedded system??)
 #define HALT {INT_OFF;  while (1) ;}
 
+//   Stop the CPU (but not the oscillator, timers, UART or interrupts) until
+// the next interrupt.  This is the 8051 idle mode, PCON.IDL ...
+#define IDLE {PCON |= 0x01;}
+
 // Public variables in the main module...
 extern char const __code g_szFirmware[];
 extern char const __code g_szCopyright[];
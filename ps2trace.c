@@ -0,0 +1,252 @@
+//++
+//ps2trace.c - decode the PS/2 APU debug trace records
+//
+// Copyright (C) 2006-2024 by Spare Time Gizmos.  All rights reserved.
+//
+// This file is part of the Spare Time Gizmos' VT1802 and VIS1802 firmware.
+//
+// This firmware is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+// Place, Suite 330, Boston, MA  02111-1307  USA.
+//
+// DESCRIPTION:
+//   This is a HOST side program (i.e. it's compiled with the host's native C
+// compiler, NOT with SDCC!) that reads the binary trace records sent by the
+// DEBUG version of the APU firmware and prints them as one readable line per
+// record.  The record format and the event codes are in trace.h.
+//
+//   The input is either a file (e.g. a capture from a terminal program) or a
+// serial port, or stdin if no file is given.  For a serial port you'll have
+// to set the baud rate first, e.g. -
+//
+//	stty -F /dev/ttyUSB0 2400 raw -echo
+//	ps2trace /dev/ttyUSB0
+//
+//   The records don't have any sync bytes, so start ps2trace before you reset
+// the APU.  Otherwise the first few lines may be garbage.
+//
+// USAGE:
+//	ps2trace [-x] [file]
+//
+//   The -x option prints the raw bytes of every record as well.
+//
+//   ps2trace only reads, so to use the monitor (see Monitor() in host.c) you
+// need to send the commands from another window, e.g. -
+//
+//	printf 'TE' >/dev/ttyUSB0
+//
+//REVISION HISTORY:
+// dd-mmm-yy    who     description
+// 16-Oct-26	RLA	New file.
+// 16-Oct-26	RLA	Decode the monitor replies.
+// 16-Oct-26	RLA	Add the startup timing records.
+// 16-Oct-26	RLA	Add TR_LAT_BUCKET.
+//--
+#include <stdio.h>		// printf(), fopen(), et al ...
+#include <stdlib.h>		// exit(), EXIT_SUCCESS, ...
+#include <stdint.h>		// uint8_t, et al ...
+#include <stdbool.h>		// bool, true, false ...
+#include <string.h>		// strcmp(), ...
+#include "trace.h"		// trace record format and event codes
+
+// How to print the data bytes of each event ...
+typedef enum {
+  DATA_NONE,			// no data bytes
+  DATA_BYTE,			// one byte, in hex
+  DATA_DECIMAL,			// one byte, in decimal
+  DATA_CHAR,			// one byte, in hex and as a character
+  DATA_WORD,			// two bytes, high first, in decimal
+  DATA_PAIR,			// two bytes, in decimal
+  DATA_START,			// the TR_START version and option bits
+  DATA_REPLY,			// a keyboard reply byte
+  DATA_RING			// a trace ring entry (see host.h)
+} DATA_TYPE;
+
+// One entry in the event table ...
+typedef struct {
+  uint8_t    bEvent;		// TR_xxx event code
+  DATA_TYPE  nData;		// how to print the data
+  const char *pszName;		// and what it means
+} EVENT;
+
+//++
+//   This table MUST agree with trace.h!  The number of data bytes is in each
+// record's header, so an event that's not in here can still be skipped.
+//--
+static const EVENT g_aEvents[] = {
+  {TR_START,	  DATA_START,	"firmware started"},
+  {TR_KEY,	  DATA_BYTE,	"keyboard sent"},
+  {TR_HOST,	  DATA_CHAR,	"sending to host"},
+  {TR_HOST_DROP,  DATA_CHAR,	"host timeout - dropping"},
+  {TR_HOST_HOLD,  DATA_NONE,	"host timeout - inhibiting keyboard"},
+  {TR_REPEAT,	  DATA_BYTE,	"repeat dropped"},
+  {TR_RESYNC,	  DATA_BYTE,	"keyboard re-initialized, flags"},
+  {TR_REPLY,	  DATA_REPLY,	"keyboard reply"},
+  {TR_WINDOWS,	  DATA_BYTE,	"Windows key pressed"},
+  {TR_PRTSC,	  DATA_BYTE,	"PRINT SCREEN pressed"},
+  {TR_UNKNOWN,	  DATA_BYTE,	"unknown scan code"},
+  {TR_UNKNOWN_E0, DATA_BYTE,	"unknown extended scan code E0"},
+  {TR_LAYOUT,	  DATA_DECIMAL,	"select layout"},
+  {TR_KEYMODE,	  DATA_DECIMAL,	"select key mode"},
+  {TR_PAUSE,	  DATA_NONE,	"PAUSE/BREAK pressed"},
+  {TR_NUMLOCK,	  DATA_NONE,	"NUM LOCK pressed"},
+  {TR_SCRLCK,	  DATA_NONE,	"SCROLL LOCK pressed"},
+  {TR_LAT_MIN,	  DATA_WORD,	"latency min"},
+  {TR_LAT_MEAN,	  DATA_WORD,	"latency mean"},
+  {TR_LAT_MAX,	  DATA_WORD,	"latency max"},
+  {TR_LAT_BUCKET, DATA_PAIR,	"latency bucket, count"},
+  {TR_STRAY_RELEASE, DATA_BYTE,	"release for a key that isn't down"},
+  {TR_READY,	  DATA_WORD,	"ready - machine cycles after reset"},
+  {TR_FIRST_KEY,  DATA_WORD,	"first key - ticks after reset"},
+  {TR_TICKS,	  DATA_WORD,	"tick count"},
+  {TR_ERR_PF,	  DATA_PAIR,	"parity, framing errors"},
+  {TR_ERR_TO,	  DATA_PAIR,	"timeout errors, overflows"},
+  {TR_RESYNCS,	  DATA_DECIMAL,	"keyboard resyncs"},
+  {TR_RX_BYTES,	  DATA_WORD,	"bytes received from keyboard"},
+  {TR_TX_BYTES,	  DATA_WORD,	"bytes sent to host"},
+  {TR_DROPS,	  DATA_WORD,	"debug output dropped"},
+  {TR_RING,	  DATA_RING,	"trace ring"},
+  {TR_BAD_COMMAND,DATA_CHAR,	"unknown monitor command"},
+  {TR_LOST,	  DATA_DECIMAL,	"trace records lost"},
+};
+#define NEVENTS	(sizeof(g_aEvents) / sizeof(g_aEvents[0]))
+
+
+//++
+// Return the name of a keyboard reply byte (see DoSpecial() in host.c) ...
+//--
+static const char *ReplyName (uint8_t bReply)
+{
+  switch (bReply) {
+    case 0xFA:	return "ACKNOWLEDGE";
+    case 0xEE:	return "ECHO";
+    case 0xFE:	return "RESEND";
+    case 0xAA:	return "SELF TEST PASSED";
+    case 0xFC:	return "SELF TEST FAILED";
+    case 0x00:
+    case 0xFF:	return "ERROR/OVERFLOW";
+    default:	return "?";
+  }
+}
+
+
+//++
+//   Return the name of a trace ring entry type.  These MUST agree with the
+// RING_xxx definitions in host.h ...
+//--
+static const char *RingName (uint8_t bTag)
+{
+  switch (bTag & 0xC0) {
+    case 0x00:	return "key";
+    case 0x40:	return "error";
+    case 0x80:	return "host";
+    default:	return "drop";
+  }
+}
+
+
+//++
+//   Print one trace record.  abData[] holds nData data bytes, which may not
+// be what the event table expects if the firmware and trace.h disagree ...
+//--
+static void PrintRecord (uint8_t bHeader, const uint8_t abData[], int nData)
+{
+  uint8_t bEvent = bHeader & TRACE_EVENT;  unsigned i;
+  const EVENT *pEvent = NULL;
+  for (i = 0;  i < NEVENTS;  ++i)
+    if (g_aEvents[i].bEvent == bEvent) pEvent = &g_aEvents[i];
+  if (pEvent == NULL) {
+    printf("unknown event 0x%02X", bEvent);
+    for (i = 0;  i < (unsigned) nData;  ++i)  printf(" 0x%02X", abData[i]);
+    putchar('\n');  return;
+  }
+
+  printf("%s", pEvent->pszName);
+  switch (pEvent->nData) {
+    case DATA_NONE:
+      break;
+    case DATA_BYTE:
+      if (nData >= 1) printf(" 0x%02X", abData[0]);
+      break;
+    case DATA_DECIMAL:
+      if (nData >= 1) printf(" %u", abData[0]);
+      break;
+    case DATA_CHAR:
+      if (nData < 1) break;
+      printf(" 0x%02X", abData[0]);
+      if ((abData[0] >= ' ') && (abData[0] < 0x7F)) printf(" '%c'", abData[0]);
+      break;
+    case DATA_WORD:
+      if (nData >= 2) printf(" %u", (abData[0] << 8) | abData[1]);
+      break;
+    case DATA_PAIR:
+      if (nData >= 2) printf(" %u, %u", abData[0], abData[1]);
+      break;
+    case DATA_START:
+      if (nData < 2) break;
+      printf(" - V%u, swap=%d, strobe=%d", abData[0],
+        (abData[1] & TR_START_SWAP) != 0, (abData[1] & TR_START_STROBE) != 0);
+      break;
+    case DATA_REPLY:
+      if (nData >= 1) printf(" 0x%02X (%s)", abData[0], ReplyName(abData[0]));
+      break;
+    case DATA_RING:
+      if (nData < 2) break;
+      printf(" %s 0x%02X at %u", RingName(abData[0]), abData[1], abData[0] & 0x3F);
+      break;
+  }
+  putchar('\n');
+}
+
+
+int main (int argc, char *argv[])
+{
+  const char *pszInput = NULL;  bool fRaw = false;  FILE *f = stdin;
+  int i, c, nData, nLength;  uint8_t bHeader, abData[2];
+
+  for (i = 1;  i < argc;  ++i) {
+    if (strcmp(argv[i], "-x") == 0)
+      fRaw = true;
+    else if ((argv[i][0] != '-') && (pszInput == NULL))
+      pszInput = argv[i];
+    else {
+      fprintf(stderr, "usage: ps2trace [-x] [file]\n");
+      return EXIT_FAILURE;
+    }
+  }
+  if ((pszInput != NULL) && ((f = fopen(pszInput, "rb")) == NULL)) {
+    fprintf(stderr, "%s: can't open file\n", pszInput);
+    return EXIT_FAILURE;
+  }
+
+  //   Read one record at a time - the header tells us how many data bytes
+  // follow it ...
+  while ((c = getc(f)) != EOF) {
+    bHeader = (uint8_t) c;  nLength = (bHeader & TRACE_LENGTH) >> 6;
+    for (nData = 0;  nData < nLength;  ++nData) {
+      if ((c = getc(f)) == EOF) break;
+      if (nData < (int) sizeof(abData)) abData[nData] = (uint8_t) c;
+    }
+    if (nData > (int) sizeof(abData)) nData = sizeof(abData);
+    if (fRaw) {
+      printf("%02X", bHeader);
+      for (i = 0;  i < nData;  ++i)  printf(" %02X", abData[i]);
+      printf("%*s", 3*(2-nData)+2, "");
+    }
+    PrintRecord(bHeader, abData, nData);
+    fflush(stdout);
+  }
+
+  if (f != stdin) fclose(f);
+  return EXIT_SUCCESS;
+}
@@ -23,12 +23,43 @@
 // dd-mmm-yy    who     description
 //  5-Feb-06	RLA	New file.
 // 12-May-24	RLA	Update for SDCC.
+// 16-Oct-26	RLA	Add multiple layouts (LAYOUT_COUNT and LAYOUT_DELTA).
+// 16-Oct-26	RLA	Add KEY_REPORT.
+// 16-Oct-26	RLA	Add the KEY_OVERFLOW..KEY_KBD_ERROR status codes.
+// 16-Oct-26	RLA	Add KEY_RELEASE.
+// 16-Oct-26	RLA	Add KEY_LATIN1.
+// 16-Oct-26	RLA	Add LAYOUT_ISO646.
 //--
 #pragma once
 
+//   The number of keyboard layouts in the firmware.  This is normally set by
+// the Makefile and is one unless several layouts are listed in LAYOUT ...
+#ifndef LAYOUT_COUNT
+#define LAYOUT_COUNT	1
+#endif
+
 // Global data definitions...
+//   The table entries are ISO 8859-1 (Latin-1) characters, except that 0x80
+// sends a NUL.  Codes 0x81..0x9F are never characters, and the host.c CHARSET
+// option decides how the Latin-1 characters, 0xA0..0xFF, are sent ...
 extern uint8_t const __code g_abScanCodes[128][4];
 
+//   Each layout also has a few ISO 646 codes of its own for Latin-1 characters
+// that only its national variant has (e.g. "§" is "@" in German).  These are
+// pairs of the Latin-1 character and its seven bit code, padded with zeros ...
+#define LAYOUT_ISO646	2	// ISO 646 codes per layout
+extern uint8_t const __code g_abLayoutISO646[LAYOUT_COUNT][LAYOUT_ISO646][2];
+
+//   When there's more than one layout, any g_abScanCodes[] entry that differs
+// between layouts holds LAYOUT_DELTA+n instead, and the real character is in
+// the n'th row of the delta table for the current layout.  The delta codes,
+// 0x81..0x9F, are never used as characters.  See mklayout.c for more ...
+#if LAYOUT_COUNT > 1
+#define LAYOUT_DELTA	0x81	// first delta row code
+#define MAXDELTAS	31	// and the number of delta row codes
+extern uint8_t const __code * const __code g_apbLayoutDeltas[LAYOUT_COUNT];
+#endif
+
 // Function keys ...
 #define KEY_BREAK	0x80	// PAUSE/BREAK KEY
 #define KEY_F1		0x81	// F1  KEY
@@ -79,5 +110,17 @@ extern uint8_t const __code g_abScanCodes[128][4];
 #define KEY_KPMINUS	0xAE	// KEYPAD -
 #define KEY_KPENTER	0xAF	// KEYPAD ENTER
 
+//   Status codes.  These tell the host that something happened to the key
+// stream - after KEY_OVERFLOW, KEY_RESYNC or KEY_BAT the host should assume
+// that keys were lost, throw away any partial escape sequence it's collecting,
+// and forget about any keys it thinks are still held down ...
+#define KEY_OVERFLOW	0xB0	// keys were lost (buffer overflow)
+#define KEY_RESYNC	0xB1	// receiver reset after a parity/framing/timeout
+#define KEY_BAT		0xB2	// keyboard reset or plugged in (self test passed)
+#define KEY_KBD_ERROR	0xB3	// keyboard self test failed
+#define KEY_RELEASE	0xB4	// the next code is a key that was released
+#define KEY_LATIN1	0xB5	// next byte is a Latin-1 character less 0x80
+#define KEY_REPORT	0xBF	// status report follows (see SendReport())
+
 // Special codes not associated with keys ...
 #define KEY_VERSION	0xC0
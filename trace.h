@@ -0,0 +1,91 @@
+//++
+//trace.h - binary trace event codes for the DEBUG version
+//
+// Copyright (C) 2006-2024 by Spare Time Gizmos.  All rights reserved.
+//
+// This file is part of the Spare Time Gizmos' VT1802 and VIS1802 firmware.
+//
+// This firmware is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by the Free
+// Software Foundation; either version 2 of the License, or (at your option)
+// any later version.
+//
+// This program is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+// more details.
+//
+// You should have received a copy of the GNU General Public License along with
+// this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+// Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//DESCRIPTION:
+//   The DEBUG version doesn't print messages - printf_tiny() and all the format
+// strings need more than the 2K that an AT89C2051 has.  Instead it sends short
+// binary trace records out the serial port, and ps2trace (a HOST program) turns
+// them back into something readable.  Each record is one header byte and zero,
+// one or two data bytes.  The upper two bits of the header are the number of
+// data bytes, and the lower six bits are one of the TR_xxx event codes here.
+//
+//   This file is included by both the firmware and ps2trace.c, so it must not
+// contain anything but #defines!
+//
+//REVISION HISTORY:
+// dd-mmm-yy    who     description
+// 16-Oct-26	RLA	New file.
+// 16-Oct-26	RLA	Add the monitor replies.
+// 16-Oct-26	RLA	Add TR_STRAY_RELEASE.
+// 16-Oct-26	RLA	Add TR_READY and TR_FIRST_KEY.
+// 16-Oct-26	RLA	Add TR_LAT_BUCKET.
+//--
+#pragma once
+
+// Trace record header bits ...
+#define TRACE_LENGTH	0xC0	// number of data bytes in this record
+#define TRACE_1BYTE	0x40	//  ... one data byte
+#define TRACE_2BYTES	0x80	//  ... two data bytes
+#define TRACE_EVENT	0x3F	// TR_xxx event code
+
+// Trace event codes (and their data bytes) ...
+#define TR_START	0x01	// firmware started (VERSION, option bits)
+#define TR_KEY		0x02	// byte received from the keyboard (scan code)
+#define TR_HOST		0x03	// byte sent to the host (byte)
+#define TR_HOST_DROP	0x04	// host timeout - byte thrown away (byte)
+#define TR_HOST_HOLD	0x05	// host timeout - keyboard inhibited
+#define TR_REPEAT	0x06	// typematic repeat thrown away (scan code)
+#define TR_RESYNC	0x07	// keyboard re-initialized (g_bKeyFlags)
+#define TR_REPLY	0x08	// ACK, ECHO, RESEND, BAT or error (reply byte)
+#define TR_WINDOWS	0x09	// Windows key pressed (scan code)
+#define TR_PRTSC	0x0A	// PRINT SCREEN pressed (scan code)
+#define TR_UNKNOWN	0x0B	// unknown scan code (scan code)
+#define TR_UNKNOWN_E0	0x0C	// unknown extended scan code (scan code)
+#define TR_LAYOUT	0x0D	// keyboard layout selected (layout)
+#define TR_KEYMODE	0x0E	// key mode selected (KEYMODE_xxx)
+#define TR_PAUSE	0x0F	// PAUSE/BREAK pressed
+#define TR_NUMLOCK	0x10	// NUM LOCK pressed
+#define TR_SCRLCK	0x11	// SCROLL LOCK pressed
+#define TR_LAT_MIN	0x12	// minimum host latency (high byte, low byte)
+#define TR_LAT_MEAN	0x13	// average	"      "     "    "     "    "
+#define TR_LAT_MAX	0x14	// maximum	"      "     "    "     "    "
+
+// Replies to the debug monitor (see Monitor() in host.c) ...
+#define TR_TICKS	0x15	// current tick count (high byte, low byte)
+#define TR_ERR_PF	0x16	// error counts (parity, framing)
+#define TR_ERR_TO	0x17	//   "     "    (timeout, overflow)
+#define TR_RESYNCS	0x18	// keyboard resyncs (count)
+#define TR_RX_BYTES	0x19	// bytes received from the keyboard (high, low)
+#define TR_TX_BYTES	0x1A	//   "   sent to the host	(high, low)
+#define TR_DROPS	0x1B	// debug output dropped (high, low)
+#define TR_RING		0x1C	// one trace ring entry (tag, data)
+#define TR_BAD_COMMAND	0x1D	// unknown monitor command (character)
+
+// More events ...
+#define TR_STRAY_RELEASE 0x1E	// release for a key that isn't down (key code)
+#define TR_READY	0x1F	// startup done (machine cycles, high, low)
+#define TR_FIRST_KEY	0x20	// first keyboard byte (ticks, high, low)
+#define TR_LAT_BUCKET	0x21	// host latency histogram (bucket, count)
+#define TR_LOST		0x3F	// trace records were lost (count, max 255)
+
+// Option bits in the TR_START record ...
+#define TR_START_SWAP	0x01	// SWAP_CAPSLOCK_AND_CONTROL is on
+#define TR_START_STROBE	0x02	// STROBE_ACT_LVL is one